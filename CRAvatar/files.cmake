@@ -9,6 +9,33 @@ set(module_headers
     ${header_include}
 )
 
+set(source_src_avatar
+    "${PROJECT_SOURCE_DIR}/src/avatar/animated_bounds.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/animated_bounds.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/animation_clip.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/animation_clip.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/animation_layer.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/animation_layer.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/asset_cache.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/asset_cache.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/avatar_library.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/avatar_library.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/avatar_loader.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/avatar_loader.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/avatar_memory_layout.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/avatar_memory_layout.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/control_joints.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/control_joints.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/cpu_skinning.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/cpu_skinning.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/crowd.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/crowd.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/skeleton_index.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/skeleton_index.hpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/skeleton_pose.cpp"
+    "${PROJECT_SOURCE_DIR}/src/avatar/skeleton_pose.hpp"
+)
+
 set(source_src_main_gui
     "${PROJECT_SOURCE_DIR}/src/main_gui/main_gui.cpp"
     "${PROJECT_SOURCE_DIR}/src/main_gui/main_gui.hpp"
@@ -17,23 +44,37 @@ set(source_src_main_gui
 set(source_src_objects
     "${PROJECT_SOURCE_DIR}/src/objects/floor.cpp"
     "${PROJECT_SOURCE_DIR}/src/objects/floor.hpp"
+    "${PROJECT_SOURCE_DIR}/src/objects/static_batch.cpp"
+    "${PROJECT_SOURCE_DIR}/src/objects/static_batch.hpp"
 )
 
 set(source_src
     "${PROJECT_SOURCE_DIR}/src/ar_system.cpp"
     "${PROJECT_SOURCE_DIR}/src/ar_system.hpp"
+    "${PROJECT_SOURCE_DIR}/src/fixed_step_physics.cpp"
+    "${PROJECT_SOURCE_DIR}/src/fixed_step_physics.hpp"
+    "${PROJECT_SOURCE_DIR}/src/frame_graph.cpp"
+    "${PROJECT_SOURCE_DIR}/src/frame_graph.hpp"
     "${PROJECT_SOURCE_DIR}/src/main.cpp"
     "${PROJECT_SOURCE_DIR}/src/main.hpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_manager.cpp"
     "${PROJECT_SOURCE_DIR}/src/openvr_manager.hpp"
+    "${PROJECT_SOURCE_DIR}/src/simulation_loop.cpp"
+    "${PROJECT_SOURCE_DIR}/src/simulation_loop.hpp"
+    "${PROJECT_SOURCE_DIR}/src/startup_profiler.cpp"
+    "${PROJECT_SOURCE_DIR}/src/startup_profiler.hpp"
+    "${PROJECT_SOURCE_DIR}/src/tracker_recording.cpp"
+    "${PROJECT_SOURCE_DIR}/src/tracker_recording.hpp"
 )
 
 # grouping
+source_group("src\\avatar" FILES ${source_src_avatar})
 source_group("src\\main_gui" FILES ${source_src_main_gui})
 source_group("src\\objects" FILES ${source_src_objects})
 source_group("src" FILES ${source_src})
 
 set(module_sources
+    ${source_src_avatar}
     ${source_src_main_gui}
     ${source_src_objects}
     ${source_src}
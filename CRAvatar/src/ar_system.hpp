@@ -18,6 +18,8 @@ public:
     ARSystem(rpcore::RenderPipeline& pipeline);
     virtual ~ARSystem();
 
+    /** Sync poses when the event is sent. If it is not set, the owner calls sync_pose(). */
+    const std::string& get_sync_event_name() const;
     void set_sync_event_name(const std::string& ev_name);
 
     void push_pose(NodePath np, const LMatrix4f& pose);
@@ -26,9 +28,9 @@ public:
     size_t get_queue_size() const;
     void set_queue_size(size_t qsize);
 
-private:
     void sync_pose();
 
+private:
     rpcore::RenderPipeline& pipeline_;
 
     std::string sync_event_name_;
@@ -43,6 +45,11 @@ inline ARSystem::ARSystem(rpcore::RenderPipeline& pipeline) : pipeline_(pipeline
 {
 }
 
+inline const std::string& ARSystem::get_sync_event_name() const
+{
+    return sync_event_name_;
+}
+
 inline void ARSystem::remove_nodepath(NodePath np)
 {
     pose_queue_.erase(np);
@@ -0,0 +1,293 @@
+#include "avatar/animated_bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+#include <boundingBox.h>
+#include <character.h>
+#include <characterJoint.h>
+#include <geomVertexReader.h>
+#include <jointVertexTransform.h>
+#include <transformBlendTable.h>
+
+#include "avatar/skeleton_pose.hpp"
+
+namespace {
+
+void collect_bind_inverses(const PartGroup* part, const LMatrix4f& parent_net,
+    std::unordered_map<const CharacterJoint*, LMatrix4f>& inverses)
+{
+    LMatrix4f net = parent_net;
+    if (part->is_of_type(CharacterJoint::get_class_type()))
+    {
+        const CharacterJoint* joint = DCAST(CharacterJoint, part);
+        net = LCAST(float, joint->get_default_value()) * parent_net;
+        inverses[joint].invert_from(net);
+    }
+
+    for (int k = 0, k_end = part->get_num_children(); k < k_end; ++k)
+        collect_bind_inverses(part->get_child(k), net, inverses);
+}
+
+void reset_bounds(LPoint3f& bounds_min, LPoint3f& bounds_max)
+{
+    bounds_min.fill((std::numeric_limits<float>::max)());
+    bounds_max.fill(std::numeric_limits<float>::lowest());
+}
+
+void extend_by_point(const LPoint3f& point, LPoint3f& bounds_min, LPoint3f& bounds_max)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds_min[axis] = (std::min)(bounds_min[axis], point[axis]);
+        bounds_max[axis] = (std::max)(bounds_max[axis], point[axis]);
+    }
+}
+
+void extend_by_joint(const LMatrix4f& net, float radius, LPoint3f& bounds_min, LPoint3f& bounds_max)
+{
+    // the radius is scaled by the largest axis of the joint
+    const float scale_sq = (std::max)({ net.get_row3(0).length_squared(), net.get_row3(1).length_squared(), net.get_row3(2).length_squared() });
+    const float r = radius * std::sqrt(scale_sq);
+    const LPoint3f center = net.get_row3(3);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds_min[axis] = (std::min)(bounds_min[axis], center[axis] - r);
+        bounds_max[axis] = (std::max)(bounds_max[axis], center[axis] + r);
+    }
+}
+
+}
+
+AnimatedBounds::AnimatedBounds(NodePath actor_np)
+{
+    const NodePathCollection characters = actor_np.find_all_matches("**/+Character");
+    for (int k = 0, k_end = characters.get_num_paths(); k < k_end; ++k)
+    {
+        const NodePath character_np = characters.get_path(k);
+
+        Part part;
+        part.character = DCAST(Character, character_np.node());
+        reset_bounds(part.static_min, part.static_max);
+
+        // inverse of bind pose maps vertices to the space of joints
+        std::unordered_map<const CharacterJoint*, LMatrix4f> bind_inverses;
+        for (int i = 0, i_end = part.character->get_num_bundles(); i < i_end; ++i)
+        {
+            const PartBundle* bundle = part.character->get_bundle(i);
+            collect_bind_inverses(bundle, LCAST(float, bundle->get_root_xform()), bind_inverses);
+        }
+
+        std::unordered_map<const CharacterJoint*, float> radii;
+        const NodePathCollection geom_nps = character_np.find_all_matches("**/+GeomNode");
+        for (int i = 0, i_end = geom_nps.get_num_paths(); i < i_end; ++i)
+        {
+            const NodePath geom_np = geom_nps.get_path(i);
+            GeomNode* geom_node = DCAST(GeomNode, geom_np.node());
+            part.geom_nodes.push_back(geom_node);
+            part.geom_transforms.push_back(LCAST(float, geom_np.get_transform(character_np)->get_mat()));
+
+            for (int g = 0, g_end = geom_node->get_num_geoms(); g < g_end; ++g)
+            {
+                CPT(GeomVertexData) vdata = geom_node->get_geom(g)->get_vertex_data();
+                const TransformBlendTable* table = vdata->get_transform_blend_table();
+
+                GeomVertexReader vertex(vdata, InternalName::get_vertex());
+                GeomVertexReader blend_index(vdata, InternalName::get_transform_blend());
+                const bool skinned = table && blend_index.has_column();
+
+                while (!vertex.is_at_end())
+                {
+                    const LPoint3f pos = vertex.get_data3f();
+                    if (!skinned)
+                    {
+                        extend_by_point(pos, part.static_min, part.static_max);
+                        continue;
+                    }
+
+                    const TransformBlend& blend = table->get_blend(blend_index.get_data1i());
+                    for (int t = 0, t_end = blend.get_num_transforms(); t < t_end; ++t)
+                    {
+                        if (blend.get_weight(t) <= 0.0f)
+                            continue;
+
+                        const VertexTransform* transform = blend.get_transform(t);
+                        const auto iter = transform->is_of_type(JointVertexTransform::get_class_type()) ?
+                            bind_inverses.find(DCAST(JointVertexTransform, transform)->get_joint()) :
+                            bind_inverses.end();
+                        if (iter == bind_inverses.end())
+                        {
+                            extend_by_point(pos, part.static_min, part.static_max);
+                            continue;
+                        }
+
+                        float& radius = radii[iter->first];
+                        radius = (std::max)(radius, iter->second.xform_point(pos).length());
+                    }
+                }
+            }
+        }
+
+        if (part.geom_nodes.empty())
+            continue;
+
+        part.joints.reserve(radii.size());
+        for (const auto& radius: radii)
+            part.joints.push_back({ radius.first, -1, radius.second });
+
+        parts_.push_back(std::move(part));
+    }
+}
+
+size_t AnimatedBounds::get_joint_count() const
+{
+    size_t count = 0;
+    for (const auto& part: parts_)
+        count += part.joints.size();
+    return count;
+}
+
+void AnimatedBounds::bind(const SkeletonPose& pose)
+{
+    for (auto&& part: parts_)
+    {
+        for (auto&& joint: part.joints)
+        {
+            joint.pose_index = -1;
+            for (size_t k = 0, k_end = pose.get_joint_count(); k < k_end; ++k)
+            {
+                if (pose.get_name(k) == joint.joint->get_name())
+                {
+                    joint.pose_index = static_cast<int>(k);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void AnimatedBounds::update()
+{
+    LMatrix4f net;
+    for (auto&& part: parts_)
+    {
+        part.character->update();
+
+        LPoint3f bounds_min = part.static_min;
+        LPoint3f bounds_max = part.static_max;
+        for (const auto& joint: part.joints)
+        {
+            joint.joint->get_net_transform(net);
+            extend_by_joint(net, joint.radius, bounds_min, bounds_max);
+        }
+
+        apply(part, bounds_min, bounds_max);
+    }
+}
+
+void AnimatedBounds::update(const SkeletonPose& pose)
+{
+    LMatrix4f net;
+    for (auto&& part: parts_)
+    {
+        LPoint3f bounds_min = part.static_min;
+        LPoint3f bounds_max = part.static_max;
+        for (const auto& joint: part.joints)
+        {
+            // joints which are not in the pose use the transforms of the last update of the character.
+            if (joint.pose_index < 0)
+                joint.joint->get_net_transform(net);
+            else
+                net = pose.get_world(static_cast<size_t>(joint.pose_index));
+            extend_by_joint(net, joint.radius, bounds_min, bounds_max);
+        }
+
+        apply(part, bounds_min, bounds_max);
+    }
+}
+
+float AnimatedBounds::measure_undershoot() const
+{
+    float undershoot = 0.0f;
+    LMatrix4f matrix;
+    for (const auto& part: parts_)
+    {
+        part.character->force_update();
+
+        for (const auto& geom_node: part.geom_nodes)
+        {
+            CPT(BoundingVolume) bounds = geom_node->get_bounds();
+            const BoundingBox* box = bounds->as_bounding_box();
+            if (!box)
+                continue;
+
+            const LPoint3f bounds_min = box->get_minq();
+            const LPoint3f bounds_max = box->get_maxq();
+
+            for (int g = 0, g_end = geom_node->get_num_geoms(); g < g_end; ++g)
+            {
+                CPT(GeomVertexData) vdata = geom_node->get_geom(g)->get_vertex_data();
+                const TransformBlendTable* table = vdata->get_transform_blend_table();
+
+                GeomVertexReader vertex(vdata, InternalName::get_vertex());
+                GeomVertexReader blend_index(vdata, InternalName::get_transform_blend());
+                const bool skinned = table && blend_index.has_column();
+
+                while (!vertex.is_at_end())
+                {
+                    const LPoint3f pos = vertex.get_data3f();
+                    LPoint3f skinned_pos = pos;
+                    if (skinned)
+                    {
+                        // linear blend skinning like the animated vertex data of Panda3D
+                        const TransformBlend& blend = table->get_blend(blend_index.get_data1i());
+                        skinned_pos = LPoint3f::zero();
+                        for (int t = 0, t_end = blend.get_num_transforms(); t < t_end; ++t)
+                        {
+                            blend.get_transform(t)->get_matrix(matrix);
+                            skinned_pos += matrix.xform_point(pos) * blend.get_weight(t);
+                        }
+                    }
+
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        undershoot = (std::max)(undershoot, bounds_min[axis] - skinned_pos[axis]);
+                        undershoot = (std::max)(undershoot, skinned_pos[axis] - bounds_max[axis]);
+                    }
+                }
+            }
+        }
+    }
+    return undershoot;
+}
+
+void AnimatedBounds::apply(Part& part, LPoint3f bounds_min, LPoint3f bounds_max)
+{
+    // no vertices
+    if (bounds_min[0] > bounds_max[0])
+        return;
+
+    // final bounds are not extended by children, so the static bounds of skinned geometry are ignored.
+    // the box is in the space of the character, and geom nodes have it in their own space.
+    PT(BoundingBox) box = new BoundingBox(bounds_min, bounds_max);
+    for (size_t k = 0, k_end = part.geom_nodes.size(); k < k_end; ++k)
+    {
+        PT(BoundingBox) geom_box = box;
+        if (!part.geom_transforms[k].is_identity())
+        {
+            LMatrix4f character_to_geom;
+            character_to_geom.invert_from(part.geom_transforms[k]);
+            geom_box = DCAST(BoundingBox, box->make_copy());
+            geom_box->xform(character_to_geom);
+        }
+
+        GeomNode* geom_node = part.geom_nodes[k];
+        geom_node->set_bounds(geom_box);
+        geom_node->set_final(true);
+    }
+
+    part.character->set_bounds(box);
+    part.character->set_final(true);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <nodePath.h>
+#include <geomNode.h>
+
+#include <vector>
+
+class Character;
+class CharacterJoint;
+class SkeletonPose;
+
+/**
+ * Bounding boxes of skinned characters which follow their joints.
+ *
+ * Each joint has the radius of the farthest vertex influenced by the joint in bind pose, so a box of
+ * joint positions inflated by the radii contains the skinned mesh in any pose of rigid joints.
+ * The boxes are set on the characters and their geometry, so they can be culled.
+ */
+class AnimatedBounds
+{
+public:
+    /** Compute radii of joints from skinned vertices of characters under @a actor_np. */
+    AnimatedBounds(NodePath actor_np);
+
+    size_t get_joint_count() const;
+
+    /** Find joints in @a pose, so bounds are updated from its world matrices without updating characters. */
+    void bind(const SkeletonPose& pose);
+
+    /** Update characters and set bounds from their joints. */
+    void update();
+
+    /** Set bounds from world matrices of @a pose which is bound. */
+    void update(const SkeletonPose& pose);
+
+    /**
+     * Skin vertices on CPU with current joints of characters and measure how far they are outside the bounds.
+     * @return  The largest distance (in units of the model). It is 0 if bounds contain the skinned mesh.
+     */
+    float measure_undershoot() const;
+
+private:
+    struct Joint
+    {
+        const CharacterJoint* joint;
+        int pose_index;                 // -1 if it is not found in the pose
+        float radius;
+    };
+
+    struct Part
+    {
+        PT(Character) character;
+        std::vector<PT(GeomNode)> geom_nodes;
+        std::vector<LMatrix4f> geom_transforms;     // geom node to character
+        std::vector<Joint> joints;
+
+        // vertices which are not skinned by joints
+        LPoint3f static_min;
+        LPoint3f static_max;
+    };
+
+    void apply(Part& part, LPoint3f bounds_min, LPoint3f bounds_max);
+
+    std::vector<Part> parts_;
+};
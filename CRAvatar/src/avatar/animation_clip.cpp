@@ -0,0 +1,667 @@
+#include "avatar/animation_clip.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <loader.h>
+#include <animBundleNode.h>
+#include <animChannel.h>
+#include <transformState.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRAVATAR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "avatar/skeleton_index.hpp"
+#include "avatar/skeleton_pose.hpp"
+
+namespace {
+
+constexpr char clip_magic[4] = { 'C', 'R', 'C', 'L' };
+constexpr uint32_t clip_version = 1;
+constexpr uint32_t invalid_joint = static_cast<uint32_t>(-1);
+
+// components except the largest one are in [-1/sqrt(2), 1/sqrt(2)].
+constexpr float quat_range = 0.70710678f;
+constexpr uint32_t quat_bits = 10;
+constexpr uint32_t quat_mask = (1u << quat_bits) - 1;
+
+struct ClipHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t source_hash[4];
+    float frame_rate;
+    uint32_t frame_count;
+    uint32_t static_count;
+    uint32_t track_count;
+    uint32_t key_count;
+    uint32_t reserved;
+};
+
+using NameData = char[SkeletonIndex::max_name_length + 1];
+
+/** Quaternion (r, i, j, k) to the index of the largest component (2 bits) and the other three (10 bits each). */
+uint32_t encode_quat(const float* q)
+{
+    uint32_t largest = 0;
+    for (uint32_t k = 1; k < 4; ++k)
+    {
+        if (std::abs(q[k]) > std::abs(q[largest]))
+            largest = k;
+    }
+
+    // the largest component is restored as positive.
+    const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint32_t packed = largest << (quat_bits * 3);
+    uint32_t shift = quat_bits * 2;
+    for (uint32_t k = 0; k < 4; ++k)
+    {
+        if (k == largest)
+            continue;
+
+        const float normalized = (q[k] * sign / quat_range + 1.0f) * 0.5f;
+        const uint32_t value = static_cast<uint32_t>(std::lround((std::min)((std::max)(normalized, 0.0f), 1.0f) * quat_mask));
+        packed |= value << shift;
+        shift -= quat_bits;
+    }
+    return packed;
+}
+
+/**
+ * Decode a block of 4 tracks in SoA: out[0..2] is position and out[3..6] is quaternion (r, i, j, k).
+ * @param block     4 packed quaternions and 4 x, y, z of 16 bits positions.
+ * @param range     4 min x, y, z and 4 scale x, y, z.
+ */
+void decode_block(const uint32_t* block, const float* range, float (*out)[AnimationClip::lane_count])
+{
+    const uint16_t* positions = reinterpret_cast<const uint16_t*>(block + AnimationClip::lane_count);
+
+#ifdef CRAVATAR_USE_SSE2
+    const __m128i zero_i = _mm_setzero_si128();
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const __m128i quantized = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(positions + axis * 4)), zero_i);
+        const __m128 value = _mm_add_ps(_mm_loadu_ps(range + axis * 4),
+            _mm_mul_ps(_mm_cvtepi32_ps(quantized), _mm_loadu_ps(range + 12 + axis * 4)));
+        _mm_storeu_ps(out[axis], value);
+    }
+
+    const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    const __m128i mask = _mm_set1_epi32(quat_mask);
+    const __m128 scale = _mm_set1_ps(2.0f * quat_range / quat_mask);
+    const __m128 offset = _mm_set1_ps(-quat_range);
+
+    const __m128i largest = _mm_srli_epi32(packed, quat_bits * 3);
+    const __m128 a = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, quat_bits * 2), mask)), scale), offset);
+    const __m128 b = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, quat_bits), mask)), scale), offset);
+    const __m128 c = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(packed, mask)), scale), offset);
+    const __m128 d = _mm_sqrt_ps(_mm_max_ps(_mm_setzero_ps(),
+        _mm_sub_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c)))));
+
+    const __m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(0)));
+    const __m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(1)));
+    const __m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(2)));
+    const __m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(3)));
+    const auto select = [](__m128 cond, __m128 x, __m128 y) { return _mm_or_ps(_mm_and_ps(cond, x), _mm_andnot_ps(cond, y)); };
+
+    // the other three are stored in order, so a component is shifted after the largest one.
+    _mm_storeu_ps(out[3], select(is0, d, a));
+    _mm_storeu_ps(out[4], select(is1, d, select(is0, a, b)));
+    _mm_storeu_ps(out[5], select(is2, d, select(_mm_or_ps(is0, is1), b, c)));
+    _mm_storeu_ps(out[6], select(is3, d, c));
+#else
+    for (size_t lane = 0; lane < AnimationClip::lane_count; ++lane)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+            out[axis][lane] = range[axis * 4 + lane] + positions[axis * 4 + lane] * range[12 + axis * 4 + lane];
+
+        const uint32_t packed = block[lane];
+        const uint32_t largest = packed >> (quat_bits * 3);
+        float values[3];
+        float sum = 0.0f;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t quantized = (packed >> (quat_bits * (2 - k))) & quat_mask;
+            values[k] = quantized * (2.0f * quat_range / quat_mask) - quat_range;
+            sum += values[k] * values[k];
+        }
+
+        int index = 0;
+        for (uint32_t k = 0; k < 4; ++k)
+            out[3 + k][lane] = k == largest ? std::sqrt((std::max)(0.0f, 1.0f - sum)) : values[index++];
+    }
+#endif
+}
+
+/** Interpolate SoA keys of 4 tracks in place of @a a. */
+void blend_block(float (*a)[AnimationClip::lane_count], const float (*b)[AnimationClip::lane_count], float t)
+{
+#ifdef CRAVATAR_USE_SSE2
+    const __m128 t4 = _mm_set1_ps(t);
+    const __m128 s4 = _mm_set1_ps(1.0f - t);
+
+    for (int k = 0; k < 3; ++k)
+    {
+        const __m128 va = _mm_loadu_ps(a[k]);
+        _mm_storeu_ps(a[k], _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b[k]), va), t4)));
+    }
+
+    __m128 qa[4];
+    __m128 qb[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        qa[k] = _mm_loadu_ps(a[3 + k]);
+        qb[k] = _mm_loadu_ps(b[3 + k]);
+    }
+
+    // nlerp in the shorter arc
+    const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qa[0], qb[0]), _mm_mul_ps(qa[1], qb[1])),
+        _mm_add_ps(_mm_mul_ps(qa[2], qb[2]), _mm_mul_ps(qa[3], qb[3])));
+    const __m128 sign_mask = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+    const __m128 tb = _mm_xor_ps(t4, sign_mask);
+
+    __m128 q[4];
+    __m128 norm = _mm_setzero_ps();
+    for (int k = 0; k < 4; ++k)
+    {
+        q[k] = _mm_add_ps(_mm_mul_ps(qa[k], s4), _mm_mul_ps(qb[k], tb));
+        norm = _mm_add_ps(norm, _mm_mul_ps(q[k], q[k]));
+    }
+    const __m128 inv_norm = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(norm, _mm_set1_ps(1e-12f))));
+    for (int k = 0; k < 4; ++k)
+        _mm_storeu_ps(a[3 + k], _mm_mul_ps(q[k], inv_norm));
+#else
+    for (size_t lane = 0; lane < AnimationClip::lane_count; ++lane)
+    {
+        for (int k = 0; k < 3; ++k)
+            a[k][lane] += (b[k][lane] - a[k][lane]) * t;
+
+        float dot = 0.0f;
+        for (int k = 3; k < 7; ++k)
+            dot += a[k][lane] * b[k][lane];
+        const float tb = dot < 0.0f ? -t : t;
+
+        float norm = 0.0f;
+        for (int k = 3; k < 7; ++k)
+        {
+            a[k][lane] = a[k][lane] * (1.0f - t) + b[k][lane] * tb;
+            norm += a[k][lane] * a[k][lane];
+        }
+        norm = 1.0f / std::sqrt((std::max)(norm, 1e-12f));
+        for (int k = 3; k < 7; ++k)
+            a[k][lane] *= norm;
+    }
+#endif
+}
+
+void write_key(float* key, const LVecBase3f& pos, const LQuaternionf& quat)
+{
+    key[0] = pos[0];
+    key[1] = pos[1];
+    key[2] = pos[2];
+    key[3] = quat.get_r();
+    key[4] = quat.get_i();
+    key[5] = quat.get_j();
+    key[6] = quat.get_k();
+}
+
+/** Position and rotation errors between two keys. */
+void measure_error(const float* a, const float* b, float& position_error, float& rotation_error)
+{
+    position_error = std::sqrt(
+        (a[0] - b[0]) * (a[0] - b[0]) +
+        (a[1] - b[1]) * (a[1] - b[1]) +
+        (a[2] - b[2]) * (a[2] - b[2]));
+    const float dot = std::abs(a[3] * b[3] + a[4] * b[4] + a[5] * b[5] + a[6] * b[6]);
+    rotation_error = 2.0f * std::acos((std::min)(dot, 1.0f));
+}
+
+void interpolate_key(const float* a, const float* b, float t, float* out)
+{
+    for (int i = 0; i < 3; ++i)
+        out[i] = a[i] + (b[i] - a[i]) * t;
+
+    float norm = 0.0f;
+    for (int i = 3; i < 7; ++i)
+    {
+        out[i] = a[i] + (b[i] - a[i]) * t;      // keys are continuous in sign
+        norm += out[i] * out[i];
+    }
+    norm = 1.0f / std::sqrt((std::max)(norm, 1e-12f));
+    for (int i = 3; i < 7; ++i)
+        out[i] *= norm;
+}
+
+void collect_channels(AnimGroup* group, std::unordered_map<std::string, AnimChannelMatrix*>& channels)
+{
+    if (group->is_of_type(AnimChannelMatrix::get_class_type()))
+        channels.emplace(group->get_name(), DCAST(AnimChannelMatrix, group));
+
+    for (int k = 0, k_end = group->get_num_children(); k < k_end; ++k)
+        collect_channels(group->get_child(k), channels);
+}
+
+}
+
+std::shared_ptr<AnimationClip> AnimationClip::load(const Filename& file, const SkeletonPose& skeleton, const CompressionSettings& settings)
+{
+    PT(PandaNode) node = Loader::get_global_ptr()->load_sync(file);
+    if (!node)
+        return nullptr;
+
+    const NodePath bundle_np = node->is_of_type(AnimBundleNode::get_class_type()) ?
+        NodePath(node) : NodePath(node).find("**/+AnimBundleNode");
+    if (bundle_np.is_empty())
+        return nullptr;
+
+    AnimBundle* bundle = DCAST(AnimBundleNode, bundle_np.node())->get_bundle();
+    std::unordered_map<std::string, AnimChannelMatrix*> channels;
+    collect_channels(bundle, channels);
+
+    std::vector<std::string> names;
+    std::vector<AnimChannelMatrix*> tracks;
+    for (size_t k = 0, k_end = skeleton.get_joint_count(); k < k_end; ++k)
+    {
+        auto iter = channels.find(skeleton.get_name(k));
+        if (iter == channels.end())
+            continue;
+        names.push_back(iter->first);
+        tracks.push_back(iter->second);
+    }
+
+    const size_t frame_count = (std::max)(1, bundle->get_num_frames());
+    const size_t track_count = tracks.size();
+    std::vector<float> frames(frame_count * track_count * key_size);
+    for (size_t frame = 0; frame < frame_count; ++frame)
+    {
+        for (size_t k = 0; k < track_count; ++k)
+        {
+            LMatrix4 mat;
+            tracks[k]->get_value(static_cast<int>(frame), mat);
+            CPT(TransformState) transform = TransformState::make_mat(mat);
+            write_key(&frames[(frame * track_count + k) * key_size], transform->get_pos(), transform->get_norm_quat());
+        }
+    }
+
+    return compress(static_cast<float>(bundle->get_base_frame_rate()), frame_count, names, frames, skeleton, settings);
+}
+
+std::shared_ptr<AnimationClip> AnimationClip::make_idle(const SkeletonPose& skeleton)
+{
+    static const std::unordered_map<std::string, float> amplitudes = {
+        { "vl1", 1.5f }, { "vt6", 1.0f }, { "vc7", 1.0f }, { "skullbase", 3.0f },
+        { "l_shoulder", 2.0f }, { "r_shoulder", 2.0f },
+    };
+
+    std::vector<std::string> names;
+    std::vector<uint32_t> joints;
+    std::vector<float> track_amplitudes;
+    for (size_t k = 0, k_end = skeleton.get_joint_count(); k < k_end; ++k)
+    {
+        auto iter = amplitudes.find(skeleton.get_name(k));
+        if (iter == amplitudes.end())
+            continue;
+        names.push_back(iter->first);
+        joints.push_back(static_cast<uint32_t>(k));
+        track_amplitudes.push_back(iter->second);
+    }
+
+    const size_t frame_count = 120;
+    const size_t track_count = names.size();
+    std::vector<float> frames(frame_count * track_count * key_size);
+    for (size_t frame = 0; frame < frame_count; ++frame)
+    {
+        const float phase = 2.0f * MathNumbers::pi_f * frame / frame_count;
+        for (size_t k = 0; k < track_count; ++k)
+        {
+            LQuaternionf sway;
+            sway.set_hpr(LVecBase3f(0, track_amplitudes[k] * std::sin(phase), track_amplitudes[k] * 0.5f * std::sin(phase * 2.0f)));
+            write_key(&frames[(frame * track_count + k) * key_size],
+                skeleton.get_local_pos(joints[k]), sway * skeleton.get_local_quat(joints[k]));
+        }
+    }
+
+    return compress(30.0f, frame_count, names, frames, skeleton, CompressionSettings());
+}
+
+std::shared_ptr<AnimationClip> AnimationClip::compress(float frame_rate, size_t frame_count,
+    const std::vector<std::string>& names, const std::vector<float>& frames,
+    const SkeletonPose& skeleton, const CompressionSettings& settings)
+{
+    // key frames are 16 bits
+    frame_count = (std::min)(frame_count, static_cast<size_t>(65536));
+
+    const size_t track_count = names.size();
+    const auto key_at = [&](std::vector<float>& keys, size_t frame, size_t track) {
+        return &keys[(frame * track_count + track) * key_size];
+    };
+
+    // normalize and make signs of quaternions continuous for interpolation.
+    std::vector<float> keys(frames.begin(), frames.begin() + frame_count * track_count * key_size);
+    for (size_t k = 0; k < track_count; ++k)
+    {
+        for (size_t frame = 0; frame < frame_count; ++frame)
+        {
+            float* key = key_at(keys, frame, k);
+            float norm = 0.0f;
+            for (int i = 3; i < 7; ++i)
+                norm += key[i] * key[i];
+            norm = 1.0f / std::sqrt((std::max)(norm, 1e-12f));
+
+            float dot = 0.0f;
+            if (frame > 0)
+            {
+                const float* prev = key_at(keys, frame - 1, k);
+                for (int i = 3; i < 7; ++i)
+                    dot += prev[i] * key[i];
+            }
+            if (dot < 0.0f)
+                norm = -norm;
+
+            for (int i = 3; i < 7; ++i)
+                key[i] *= norm;
+        }
+    }
+
+    auto clip = std::make_shared<AnimationClip>();
+    clip->frame_rate_ = frame_rate;
+    clip->frame_count_ = frame_count;
+
+    // split static tracks
+    std::vector<size_t> animated_tracks;
+    for (size_t k = 0; k < track_count; ++k)
+    {
+        bool is_static = true;
+        for (size_t frame = 1; frame < frame_count && is_static; ++frame)
+        {
+            float position_error;
+            float rotation_error;
+            measure_error(key_at(keys, 0, k), key_at(keys, frame, k), position_error, rotation_error);
+            is_static = position_error <= settings.position_error && rotation_error <= settings.rotation_error;
+        }
+
+        if (is_static)
+        {
+            clip->static_names_.push_back(names[k]);
+            const float* key = key_at(keys, 0, k);
+            clip->static_keys_.insert(clip->static_keys_.end(), key, key + key_size);
+        }
+        else
+        {
+            clip->names_.push_back(names[k]);
+            animated_tracks.push_back(k);
+        }
+    }
+
+    // remove frames which are interpolated within the error from the last key.
+    const auto is_reproduced = [&](size_t begin, size_t end) {
+        float interpolated[key_size];
+        for (size_t frame = begin + 1; frame < end; ++frame)
+        {
+            const float t = static_cast<float>(frame - begin) / (end - begin);
+            for (const size_t k: animated_tracks)
+            {
+                interpolate_key(key_at(keys, begin, k), key_at(keys, end, k), t, interpolated);
+
+                float position_error;
+                float rotation_error;
+                measure_error(interpolated, key_at(keys, frame, k), position_error, rotation_error);
+                if (position_error > settings.position_error || rotation_error > settings.rotation_error)
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    clip->key_frames_.push_back(0);
+    if (!animated_tracks.empty() && frame_count > 1)
+    {
+        size_t begin = 0;
+        for (size_t end = 2; end < frame_count; ++end)
+        {
+            if (!is_reproduced(begin, end))
+            {
+                begin = end - 1;
+                clip->key_frames_.push_back(static_cast<uint16_t>(begin));
+            }
+        }
+        clip->key_frames_.push_back(static_cast<uint16_t>(frame_count - 1));
+    }
+
+    // ranges and quantized blocks
+    const size_t animated_count = animated_tracks.size();
+    clip->group_count_ = (animated_count + lane_count - 1) / lane_count;
+    clip->ranges_.assign(clip->group_count_ * range_size, 0.0f);
+    clip->blocks_.assign(clip->key_frames_.size() * clip->group_count_ * block_size, 0);
+
+    for (size_t i = 0; i < animated_count; ++i)
+    {
+        const size_t k = animated_tracks[i];
+        float* range = &clip->ranges_[(i / lane_count) * range_size];
+        const size_t lane = i % lane_count;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float min_value = key_at(keys, 0, k)[axis];
+            float max_value = min_value;
+            for (size_t frame = 1; frame < frame_count; ++frame)
+            {
+                min_value = (std::min)(min_value, key_at(keys, frame, k)[axis]);
+                max_value = (std::max)(max_value, key_at(keys, frame, k)[axis]);
+            }
+            range[axis * 4 + lane] = min_value;
+            range[12 + axis * 4 + lane] = (max_value - min_value) / 65535.0f;
+        }
+
+        for (size_t key_index = 0, key_end = clip->key_frames_.size(); key_index < key_end; ++key_index)
+        {
+            const float* key = key_at(keys, clip->key_frames_[key_index], k);
+            uint32_t* block = &clip->blocks_[(key_index * clip->group_count_ + i / lane_count) * block_size];
+            uint16_t* positions = reinterpret_cast<uint16_t*>(block + lane_count);
+
+            block[lane] = encode_quat(key + 3);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const float scale = range[12 + axis * 4 + lane];
+                const float quantized = scale > 0.0f ? (key[axis] - range[axis * 4 + lane]) / scale : 0.0f;
+                positions[axis * 4 + lane] = static_cast<uint16_t>(std::lround((std::min)((std::max)(quantized, 0.0f), 65535.0f)));
+            }
+        }
+    }
+
+    // identity quaternion in padding lanes
+    for (size_t i = animated_count, i_end = clip->group_count_ * lane_count; i < i_end; ++i)
+    {
+        const float identity[4] = { 1, 0, 0, 0 };
+        for (size_t key_index = 0, key_end = clip->key_frames_.size(); key_index < key_end; ++key_index)
+            clip->blocks_[(key_index * clip->group_count_ + i / lane_count) * block_size + i % lane_count] = encode_quat(identity);
+    }
+
+    clip->resolve(skeleton);
+
+    return clip;
+}
+
+void AnimationClip::resolve(const SkeletonPose& skeleton)
+{
+    std::unordered_map<std::string, uint32_t> joint_indices;
+    for (size_t k = 0, k_end = skeleton.get_joint_count(); k < k_end; ++k)
+        joint_indices.emplace(skeleton.get_name(k), static_cast<uint32_t>(k));
+
+    const auto find_joint = [&](const std::string& name) {
+        auto iter = joint_indices.find(name);
+        return iter == joint_indices.end() ? invalid_joint : iter->second;
+    };
+
+    static_joints_.clear();
+    for (const auto& name: static_names_)
+        static_joints_.push_back(find_joint(name));
+
+    joints_.assign(group_count_ * lane_count, invalid_joint);
+    for (size_t k = 0, k_end = names_.size(); k < k_end; ++k)
+        joints_[k] = find_joint(names_[k]);
+}
+
+std::shared_ptr<AnimationClip> AnimationClip::read(const Filename& file, const SkeletonPose& skeleton, const HashVal* source_hash)
+{
+    std::ifstream ifs(file.to_os_specific(), std::ios::binary);
+    if (!ifs)
+        return nullptr;
+
+    ClipHeader header;
+    if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, clip_magic, sizeof(header.magic)) != 0 ||
+        header.version != clip_version)
+    {
+        return nullptr;
+    }
+
+    if (source_hash)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            if (header.source_hash[k] != source_hash->get_value(k))
+                return nullptr;
+        }
+    }
+
+    auto clip = std::make_shared<AnimationClip>();
+    clip->frame_rate_ = header.frame_rate;
+    clip->frame_count_ = header.frame_count;
+    clip->group_count_ = (header.track_count + lane_count - 1) / lane_count;
+
+    const auto read_names = [&ifs](std::vector<std::string>& names, size_t count) {
+        NameData name;
+        for (size_t k = 0; k < count && ifs.read(name, sizeof(name)); ++k)
+            names.emplace_back(name, strnlen(name, sizeof(name)));
+    };
+    read_names(clip->static_names_, header.static_count);
+    read_names(clip->names_, header.track_count);
+
+    clip->static_keys_.resize(header.static_count * key_size);
+    clip->key_frames_.resize(header.key_count);
+    clip->ranges_.resize(clip->group_count_ * range_size);
+    clip->blocks_.resize(header.key_count * clip->group_count_ * block_size);
+
+    ifs.read(reinterpret_cast<char*>(clip->static_keys_.data()), clip->static_keys_.size() * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(clip->key_frames_.data()), clip->key_frames_.size() * sizeof(uint16_t));
+    ifs.read(reinterpret_cast<char*>(clip->ranges_.data()), clip->ranges_.size() * sizeof(float));
+    ifs.read(reinterpret_cast<char*>(clip->blocks_.data()), clip->blocks_.size() * sizeof(uint32_t));
+    if (!ifs || clip->names_.size() != header.track_count || clip->static_names_.size() != header.static_count)
+        return nullptr;
+
+    clip->resolve(skeleton);
+
+    return clip;
+}
+
+bool AnimationClip::write(const Filename& file, const HashVal& source_hash) const
+{
+    // names are not truncated, so that tracks are not bound to other joints.
+    for (const auto* names: { &static_names_, &names_ })
+    {
+        for (const auto& name: *names)
+        {
+            if (name.length() > SkeletonIndex::max_name_length)
+                return false;
+        }
+    }
+
+    ClipHeader header = {};
+    std::memcpy(header.magic, clip_magic, sizeof(header.magic));
+    header.version = clip_version;
+    for (int k = 0; k < 4; ++k)
+        header.source_hash[k] = source_hash.get_value(k);
+    header.frame_rate = frame_rate_;
+    header.frame_count = static_cast<uint32_t>(frame_count_);
+    header.static_count = static_cast<uint32_t>(static_names_.size());
+    header.track_count = static_cast<uint32_t>(names_.size());
+    header.key_count = static_cast<uint32_t>(key_frames_.size());
+
+    Filename(file).make_dir();
+
+    std::ofstream ofs(file.to_os_specific(), std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        return false;
+
+    const auto write_names = [&ofs](const std::vector<std::string>& names) {
+        for (const auto& name: names)
+        {
+            NameData data = {};
+            std::memcpy(data, name.c_str(), name.length());
+            ofs.write(data, sizeof(data));
+        }
+    };
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_names(static_names_);
+    write_names(names_);
+    ofs.write(reinterpret_cast<const char*>(static_keys_.data()), static_keys_.size() * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(key_frames_.data()), key_frames_.size() * sizeof(uint16_t));
+    ofs.write(reinterpret_cast<const char*>(ranges_.data()), ranges_.size() * sizeof(float));
+    ofs.write(reinterpret_cast<const char*>(blocks_.data()), blocks_.size() * sizeof(uint32_t));
+
+    return ofs.good();
+}
+
+size_t AnimationClip::get_memory_usage() const
+{
+    return static_keys_.size() * sizeof(float) +
+        key_frames_.size() * sizeof(uint16_t) +
+        ranges_.size() * sizeof(float) +
+        blocks_.size() * sizeof(uint32_t);
+}
+
+void AnimationClip::sample(double time, float* out) const
+{
+    for (size_t k = 0, k_end = static_joints_.size(); k < k_end; ++k)
+    {
+        if (static_joints_[k] != invalid_joint)
+            std::copy_n(&static_keys_[k * key_size], key_size, out + static_joints_[k] * key_size);
+    }
+
+    if (frame_count_ == 0 || group_count_ == 0)
+        return;
+
+    double frame = std::fmod(time * frame_rate_, static_cast<double>(frame_count_));
+    if (frame < 0)
+        frame += frame_count_;
+
+    // the last key is interpolated to the first key in a loop.
+    const size_t key_count = key_frames_.size();
+    const size_t key1 = std::upper_bound(key_frames_.begin(), key_frames_.end(), static_cast<uint16_t>(frame)) - key_frames_.begin();
+    const size_t key0 = key1 - 1;
+    const double frame0 = key_frames_[key0];
+    const double frame1 = key1 < key_count ? key_frames_[key1] : static_cast<double>(frame_count_);
+    const float t = frame1 > frame0 ? static_cast<float>((frame - frame0) / (frame1 - frame0)) : 0.0f;
+
+    const uint32_t* blocks0 = &blocks_[key0 * group_count_ * block_size];
+    const uint32_t* blocks1 = &blocks_[(key1 < key_count ? key1 : 0) * group_count_ * block_size];
+
+    float a[key_size][lane_count];
+    float b[key_size][lane_count];
+    for (size_t group = 0; group < group_count_; ++group)
+    {
+        const float* range = &ranges_[group * range_size];
+        decode_block(blocks0 + group * block_size, range, a);
+        decode_block(blocks1 + group * block_size, range, b);
+        blend_block(a, b, t);
+
+        for (size_t lane = 0; lane < lane_count; ++lane)
+        {
+            const uint32_t joint = joints_[group * lane_count + lane];
+            if (joint == invalid_joint)
+                continue;
+
+            float* key = out + joint * key_size;
+            for (size_t i = 0; i < key_size; ++i)
+                key[i] = a[i][lane];
+        }
+    }
+}
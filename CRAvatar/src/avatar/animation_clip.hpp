@@ -0,0 +1,116 @@
+#pragma once
+
+#include <filename.h>
+#include <hashVal.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class SkeletonPose;
+
+/**
+ * Compressed joint tracks of an animation which are resolved for a skeleton.
+ *
+ * Rotations are quantized with the smallest-three encoding in 32 bits, and positions are quantized
+ * to 16 bits in the range of each track. Tracks which do not move are stored once, and frames which are
+ * reproduced by interpolation within the error threshold are removed.
+ * Keys of a frame are stored in groups of 4 tracks, so a frame of the whole skeleton is decoded in one pass.
+ */
+class AnimationClip
+{
+public:
+    /** Number of floats of a joint in sampled buffers: position and quaternion (r, i, j, k). */
+    static constexpr size_t key_size = 7;
+    static constexpr size_t lane_count = 4;
+
+    struct CompressionSettings
+    {
+        float position_error = 0.05f;       // cm
+        float rotation_error = 0.002f;      // radian
+    };
+
+    /** Load the first AnimBundle in @a file (.bam or .egg) and compress tracks of joints in @a skeleton. */
+    static std::shared_ptr<AnimationClip> load(const Filename& file, const SkeletonPose& skeleton,
+        const CompressionSettings& settings = CompressionSettings());
+
+    /** Procedural idle which sways the spine and the head. */
+    static std::shared_ptr<AnimationClip> make_idle(const SkeletonPose& skeleton);
+
+    /**
+     * Read a compressed clip (.crclip).
+     * @param source_hash   If it is not null, the clip should be cooked from the source with the hash.
+     */
+    static std::shared_ptr<AnimationClip> read(const Filename& file, const SkeletonPose& skeleton,
+        const HashVal* source_hash = nullptr);
+
+    /** Write the compressed clip. It fails if a name of the tracks is longer than SkeletonIndex::max_name_length. */
+    bool write(const Filename& file, const HashVal& source_hash = HashVal()) const;
+
+    float get_frame_rate() const;
+    size_t get_frame_count() const;
+    size_t get_track_count() const;
+    size_t get_key_count() const;
+    double get_duration() const;
+
+    size_t get_memory_usage() const;
+
+    /**
+     * Sample all tracks at @a time (looped) into @a out which has key_size floats per joint of the skeleton.
+     * Joints without tracks are not touched.
+     */
+    void sample(double time, float* out) const;
+
+private:
+    static std::shared_ptr<AnimationClip> compress(float frame_rate, size_t frame_count,
+        const std::vector<std::string>& names, const std::vector<float>& frames,
+        const SkeletonPose& skeleton, const CompressionSettings& settings);
+
+    void resolve(const SkeletonPose& skeleton);
+
+    // keys of 4 tracks
+    static constexpr size_t block_size = lane_count + lane_count * 3 / 2;      // in uint32
+    static constexpr size_t range_size = lane_count * 6;                        // min and scale of xyz
+
+    float frame_rate_ = 30.0f;
+    size_t frame_count_ = 0;
+
+    std::vector<std::string> static_names_;
+    std::vector<uint32_t> static_joints_;
+    std::vector<float> static_keys_;            // [track][key_size]
+
+    std::vector<std::string> names_;            // animated tracks
+    std::vector<uint32_t> joints_;              // padded to groups. padding or unknown joint is -1.
+    size_t group_count_ = 0;
+
+    std::vector<uint16_t> key_frames_;
+    std::vector<float> ranges_;                 // [group][range_size]
+    std::vector<uint32_t> blocks_;              // [key][group][block_size]
+};
+
+// ************************************************************************************************
+
+inline float AnimationClip::get_frame_rate() const
+{
+    return frame_rate_;
+}
+
+inline size_t AnimationClip::get_frame_count() const
+{
+    return frame_count_;
+}
+
+inline size_t AnimationClip::get_track_count() const
+{
+    return static_names_.size() + names_.size();
+}
+
+inline size_t AnimationClip::get_key_count() const
+{
+    return key_frames_.size();
+}
+
+inline double AnimationClip::get_duration() const
+{
+    return frame_count_ / static_cast<double>(frame_rate_);
+}
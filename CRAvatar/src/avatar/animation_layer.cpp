@@ -0,0 +1,172 @@
+#include "avatar/animation_layer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <character.h>
+
+#include "avatar/animation_clip.hpp"
+#include "avatar/skeleton_index.hpp"
+
+AnimationLayer::AnimationLayer(const SkeletonIndex& skeleton): pose_(skeleton)
+{
+    // joints without tracks stay in the bind pose.
+    const size_t joint_count = pose_.get_joint_count();
+    for (auto&& keys: keys_)
+    {
+        keys.resize(joint_count * AnimationClip::key_size);
+        for (size_t k = 0; k < joint_count; ++k)
+        {
+            float* key = &keys[k * AnimationClip::key_size];
+            const LVecBase3f pos = pose_.get_local_pos(k);
+            const LQuaternionf quat = pose_.get_local_quat(k);
+            key[0] = pos[0];
+            key[1] = pos[1];
+            key[2] = pos[2];
+            key[3] = quat.get_r();
+            key[4] = quat.get_i();
+            key[5] = quat.get_j();
+            key[6] = quat.get_k();
+        }
+    }
+}
+
+AnimationLayer::~AnimationLayer() = default;
+
+void AnimationLayer::set_clip(Slot slot, const std::shared_ptr<const AnimationClip>& clip)
+{
+    clips_[static_cast<size_t>(slot)] = clip;
+}
+
+size_t AnimationLayer::bind(NodePath actor_np, const std::unordered_set<std::string>& ik_joints)
+{
+    ik_joints_.clear();
+
+    std::unordered_set<std::string> joint_names;
+    for (size_t k = 0, k_end = pose_.get_joint_count(); k < k_end; ++k)
+    {
+        const std::string& name = pose_.get_name(k);
+        if (ik_joints.find(name) == ik_joints.end())
+        {
+            joint_names.insert(name);
+            continue;
+        }
+
+        NodePath np = actor_np.find("**/" + name);
+        if (!np.is_empty())
+            ik_joints_.push_back({ k, np, 1.0f, np.get_pos(), np.get_pos() });
+    }
+
+    const NodePath character_np = actor_np.find("**/+Character");
+    if (character_np.is_empty())
+        return 0;
+
+    return pose_.bind(DCAST(Character, character_np.node()), joint_names);
+}
+
+void AnimationLayer::set_ik_weight(const std::string& joint_name, float weight)
+{
+    for (auto&& joint: ik_joints_)
+    {
+        if (pose_.get_name(joint.index) == joint_name)
+            joint.weight = weight;
+    }
+}
+
+void AnimationLayer::update(double dt)
+{
+    animate(dt);
+    apply();
+}
+
+void AnimationLayer::animate(double dt)
+{
+    time_ += dt;
+
+    const auto& idle = clips_[static_cast<size_t>(Slot::idle)];
+    const auto& locomotion = clips_[static_cast<size_t>(Slot::locomotion)];
+    auto& idle_keys = keys_[static_cast<size_t>(Slot::idle)];
+    auto& locomotion_keys = keys_[static_cast<size_t>(Slot::locomotion)];
+
+    if (idle)
+        idle->sample(time_, idle_keys.data());
+
+    const float w = locomotion ? (std::min)((std::max)(locomotion_weight_, 0.0f), 1.0f) : 0.0f;
+    if (w > 0.0f)
+        locomotion->sample(time_, locomotion_keys.data());
+
+    // blend clips in one pass
+    for (size_t k = 0, k_end = pose_.get_joint_count(); k < k_end; ++k)
+    {
+        const float* a = &idle_keys[k * AnimationClip::key_size];
+        if (w <= 0.0f)
+        {
+            pose_.set_local_pos(k, LVecBase3f(a[0], a[1], a[2]));
+            pose_.set_local_quat(k, LQuaternionf(a[3], a[4], a[5], a[6]));
+            continue;
+        }
+
+        const float* b = &locomotion_keys[k * AnimationClip::key_size];
+        const float dot = a[3] * b[3] + a[4] * b[4] + a[5] * b[5] + a[6] * b[6];
+        const float wb = dot < 0.0f ? -w : w;
+
+        LQuaternionf quat(
+            a[3] * (1.0f - w) + b[3] * wb,
+            a[4] * (1.0f - w) + b[4] * wb,
+            a[5] * (1.0f - w) + b[5] * wb,
+            a[6] * (1.0f - w) + b[6] * wb);
+        quat.normalize();
+
+        pose_.set_local_pos(k, LVecBase3f(a[0] + (b[0] - a[0]) * w, a[1] + (b[1] - a[1]) * w, a[2] + (b[2] - a[2]) * w));
+        pose_.set_local_quat(k, quat);
+    }
+
+    pose_.build_local_matrices();
+}
+
+void AnimationLayer::apply()
+{
+    pose_.publish();
+
+    // IK writes positions only, so rotations come from the clips.
+    ik_write_count_ = 0;
+    ik_skipped_count_ = 0;
+    for (auto&& joint: ik_joints_)
+    {
+        bool written = false;
+
+        const LQuaternionf quat = pose_.get_local_quat(joint.index);
+        if (!joint.np.get_quat().almost_equal(quat, SkeletonPose::publish_epsilon))
+        {
+            joint.np.set_quat(quat);
+            written = true;
+        }
+
+        // the node keeps the blended position if IK did not run after the last update.
+        const LVecBase3f current_pos = joint.np.get_pos();
+        if (current_pos != joint.written_pos)
+            joint.ik_pos = current_pos;
+
+        if (joint.weight < 1.0f)
+        {
+            const LVecBase3f anim_pos = pose_.get_local_pos(joint.index);
+            const LVecBase3f pos = anim_pos + (joint.ik_pos - anim_pos) * joint.weight;
+            if (!current_pos.almost_equal(pos, SkeletonPose::publish_epsilon))
+            {
+                joint.np.set_pos(pos);
+                written = true;
+            }
+        }
+
+        if (written)
+            ++ik_write_count_;
+        else
+            ++ik_skipped_count_;
+
+        joint.written_pos = joint.np.get_pos();
+        pose_.set_local_pos(joint.index, joint.written_pos);
+    }
+
+    // world matrices include IK results for bounds
+    pose_.compute_world();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <nodePath.h>
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "avatar/skeleton_pose.hpp"
+
+class AnimationClip;
+class SkeletonIndex;
+
+/**
+ * Plays idle and locomotion clips on a skeleton and blends IK results on top of them.
+ *
+ * Joints driven by IK keep their control nodes, and their positions are blended between the clips
+ * and the IK with per-joint weights. The other joints are published to the character.
+ */
+class AnimationLayer
+{
+public:
+    enum class Slot
+    {
+        idle = 0,
+        locomotion,
+
+        count,
+    };
+
+    AnimationLayer(const SkeletonIndex& skeleton);
+    ~AnimationLayer();
+
+    const SkeletonPose& get_pose() const;
+
+    void set_clip(Slot slot, const std::shared_ptr<const AnimationClip>& clip);
+
+    /** Blend weight of the locomotion clip over the idle clip. */
+    float get_locomotion_weight() const;
+    void set_locomotion_weight(float weight);
+
+    /**
+     * Take control of joints of the actor except @a ik_joints which are found as nodes.
+     * @return  The number of bound joints.
+     */
+    size_t bind(NodePath actor_np, const std::unordered_set<std::string>& ik_joints);
+
+    /** Weight of IK result of the joint. 1 uses IK only, and 0 uses the clips only. */
+    void set_ik_weight(const std::string& joint_name, float weight);
+
+    /**
+     * Advance clips and write the blended pose. It should be called after IK is solved.
+     * World matrices of the pose are computed with positions of IK joints.
+     */
+    void update(double dt);
+
+    /** Advance clips and blend them into the pose. It does not touch the scene graph, so it can run on a worker thread. */
+    void animate(double dt);
+
+    /** Write the pose blended by animate() to the character and the IK joints. It runs on the main thread after IK. */
+    void apply();
+
+    /** The number of joints which are written or skipped because they are not changed in the last update. */
+    size_t get_write_count() const;
+    size_t get_skipped_count() const;
+
+private:
+    struct IKJoint
+    {
+        size_t index;
+        NodePath np;
+        float weight;
+
+        LVecBase3f ik_pos;          // last position written by IK
+        LVecBase3f written_pos;     // position written by the last update
+    };
+
+    SkeletonPose pose_;
+
+    std::shared_ptr<const AnimationClip> clips_[static_cast<size_t>(Slot::count)];
+    std::vector<float> keys_[static_cast<size_t>(Slot::count)];     // sampled keys of each clip
+    float locomotion_weight_ = 0.0f;
+    double time_ = 0;
+
+    std::vector<IKJoint> ik_joints_;
+    size_t ik_write_count_ = 0;
+    size_t ik_skipped_count_ = 0;
+};
+
+// ************************************************************************************************
+
+inline const SkeletonPose& AnimationLayer::get_pose() const
+{
+    return pose_;
+}
+
+inline float AnimationLayer::get_locomotion_weight() const
+{
+    return locomotion_weight_;
+}
+
+inline void AnimationLayer::set_locomotion_weight(float weight)
+{
+    locomotion_weight_ = weight;
+}
+
+inline size_t AnimationLayer::get_write_count() const
+{
+    return pose_.get_published_count() + ik_write_count_;
+}
+
+inline size_t AnimationLayer::get_skipped_count() const
+{
+    return pose_.get_skipped_count() + ik_skipped_count_;
+}
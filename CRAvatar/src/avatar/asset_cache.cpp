@@ -0,0 +1,110 @@
+#include "avatar/asset_cache.hpp"
+
+#include "avatar/animation_clip.hpp"
+#include "avatar/skeleton_index.hpp"
+
+AssetCache::AssetCache(const Filename& cache_dir): cache_dir_(cache_dir)
+{
+}
+
+AssetCache::~AssetCache() = default;
+
+bool AssetCache::find(const Filename& source_file, Filename& model_file, std::shared_ptr<SkeletonIndex>& skeleton)
+{
+    const HashVal* source_hash = get_source_hash(source_file);
+    if (!source_hash)
+        return false;
+
+    auto index = std::make_shared<SkeletonIndex>();
+    if (!index->open(get_skeleton_file(source_file)) || !index->is_valid_for(*source_hash))
+        return false;
+
+    const Filename cooked_model_file = is_binary(source_file) ? source_file : get_model_file(source_file);
+    if (!cooked_model_file.exists())
+        return false;
+
+    model_file = cooked_model_file;
+    skeleton = std::move(index);
+
+    return true;
+}
+
+bool AssetCache::cook(const Filename& source_file, NodePath model, std::shared_ptr<SkeletonIndex>& skeleton)
+{
+    const HashVal* source_hash = get_source_hash(source_file);
+    if (!source_hash || model.is_empty())
+        return false;
+
+    // the skeleton index is written last, so it validates the cooked model, too.
+    if (!is_binary(source_file))
+    {
+        Filename cooked_model_file = get_model_file(source_file);
+        cooked_model_file.make_dir();
+        if (!model.write_bam_file(cooked_model_file))
+            return false;
+    }
+
+    const Filename skeleton_file = get_skeleton_file(source_file);
+    if (!SkeletonIndex::write(skeleton_file, *source_hash, model))
+        return false;
+
+    auto index = std::make_shared<SkeletonIndex>();
+    if (!index->open(skeleton_file))
+        return false;
+
+    skeleton = std::move(index);
+
+    return true;
+}
+
+std::shared_ptr<AnimationClip> AssetCache::load_clip(const Filename& source_file, const SkeletonPose& skeleton)
+{
+    const HashVal* source_hash = get_source_hash(source_file);
+    if (!source_hash)
+        return nullptr;
+
+    const Filename clip_file = get_clip_file(source_file);
+    if (auto clip = AnimationClip::read(clip_file, skeleton, source_hash))
+        return clip;
+
+    auto clip = AnimationClip::load(source_file, skeleton);
+    if (clip)
+        clip->write(clip_file, *source_hash);
+
+    return clip;
+}
+
+bool AssetCache::is_binary(const Filename& source_file) const
+{
+    return source_file.get_extension() == "bam";
+}
+
+Filename AssetCache::get_model_file(const Filename& source_file) const
+{
+    return Filename(cache_dir_, source_file.get_basename_wo_extension() + ".bam");
+}
+
+Filename AssetCache::get_skeleton_file(const Filename& source_file) const
+{
+    return Filename(cache_dir_, source_file.get_basename_wo_extension() + ".skel");
+}
+
+Filename AssetCache::get_clip_file(const Filename& source_file) const
+{
+    // <avatar>/animations/<clip> to <avatar>/<clip>.crclip
+    const Filename avatar_dir = Filename(source_file.get_dirname()).get_dirname();
+    return Filename(Filename(cache_dir_, avatar_dir.get_basename()), source_file.get_basename_wo_extension() + ".crclip");
+}
+
+const HashVal* AssetCache::get_source_hash(const Filename& source_file)
+{
+    auto iter = source_hashes_.find(source_file.get_fullpath());
+    if (iter != source_hashes_.end())
+        return &iter->second;
+
+    HashVal hash;
+    if (!hash.hash_file(source_file))
+        return nullptr;
+
+    return &source_hashes_.emplace(source_file.get_fullpath(), hash).first->second;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <nodePath.h>
+#include <hashVal.h>
+
+#include <memory>
+#include <unordered_map>
+
+class SkeletonIndex;
+class SkeletonPose;
+class AnimationClip;
+
+/**
+ * On-disk cache of cooked avatar models.
+ *
+ * A source model is cooked to a binary model (.bam) and a skeleton index (.skel) in the cache directory.
+ * The cooked files are validated by the content hash of the source, and the skeleton index is memory-mapped.
+ */
+class AssetCache
+{
+public:
+    AssetCache(const Filename& cache_dir);
+    ~AssetCache();
+
+    /**
+     * Find cooked files of @a source_file which are valid for the current content of the source.
+     * @param[out] model_file   Model file to load. It is the source itself if the source is already binary.
+     */
+    bool find(const Filename& source_file, Filename& model_file, std::shared_ptr<SkeletonIndex>& skeleton);
+
+    /** Cook the loaded model of @a source_file and open its skeleton index. */
+    bool cook(const Filename& source_file, NodePath model, std::shared_ptr<SkeletonIndex>& skeleton);
+
+    /** Read the compressed clip of @a source_file (.bam or .egg), or compress and write it. */
+    std::shared_ptr<AnimationClip> load_clip(const Filename& source_file, const SkeletonPose& skeleton);
+
+private:
+    bool is_binary(const Filename& source_file) const;
+    Filename get_model_file(const Filename& source_file) const;
+    Filename get_skeleton_file(const Filename& source_file) const;
+    Filename get_clip_file(const Filename& source_file) const;
+    const HashVal* get_source_hash(const Filename& source_file);
+
+    Filename cache_dir_;
+    std::unordered_map<std::string, HashVal> source_hashes_;
+};
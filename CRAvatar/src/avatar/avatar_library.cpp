@@ -0,0 +1,221 @@
+#include "avatar/avatar_library.hpp"
+
+#include "avatar/skeleton_index.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include <geomNode.h>
+#include <character.h>
+#include <texturePool.h>
+
+#include <crsf/CRModel/TActorObject.h>
+
+namespace {
+
+size_t count_parts(const PartGroup* part)
+{
+    size_t count = 1;
+    for (int k = 0, k_end = part->get_num_children(); k < k_end; ++k)
+        count += count_parts(part->get_child(k));
+    return count;
+}
+
+/** Count vertex arrays and primitives of the model which are not in @a counted yet. */
+size_t count_geometry(NodePath model, std::unordered_set<const void*>& counted)
+{
+    size_t bytes = 0;
+
+    const NodePathCollection geom_nodes = model.find_all_matches("**/+GeomNode");
+    for (int k = 0, k_end = geom_nodes.get_num_paths(); k < k_end; ++k)
+    {
+        const GeomNode* geom_node = DCAST(GeomNode, geom_nodes.get_path(k).node());
+        for (int i = 0, i_end = geom_node->get_num_geoms(); i < i_end; ++i)
+        {
+            CPT(Geom) geom = geom_node->get_geom(i);
+
+            // copies of characters have their own vertex data which share arrays.
+            CPT(GeomVertexData) vdata = geom->get_vertex_data();
+            for (size_t j = 0, j_end = vdata->get_num_arrays(); j < j_end; ++j)
+            {
+                CPT(GeomVertexArrayData) array = vdata->get_array(j);
+                if (counted.insert(array.p()).second)
+                    bytes += array->get_data_size_bytes();
+            }
+
+            for (size_t j = 0, j_end = geom->get_num_primitives(); j < j_end; ++j)
+            {
+                CPT(GeomPrimitive) prim = geom->get_primitive(j);
+                if (counted.insert(prim.p()).second)
+                    bytes += prim->get_num_bytes();
+            }
+        }
+    }
+
+    return bytes;
+}
+
+size_t count_joints(NodePath model)
+{
+    size_t bytes = 0;
+    const NodePathCollection characters = model.find_all_matches("**/+Character");
+    for (int k = 0, k_end = characters.get_num_paths(); k < k_end; ++k)
+    {
+        const Character* character = DCAST(Character, characters.get_path(k).node());
+        for (int i = 0, i_end = character->get_num_bundles(); i < i_end; ++i)
+            bytes += count_parts(character->get_bundle(i)) * sizeof(CharacterJoint);
+    }
+    return bytes;
+}
+
+}
+
+size_t AvatarLibrary::scan(const Filename& base_dir)
+{
+    entries_.clear();
+
+    vector_string paths;
+    if (!base_dir.scan_directory(paths))
+        return 0;
+
+    for (const auto& path: paths)
+    {
+        Filename model_file = base_dir / path / (path + ".bam");
+        if (!model_file.exists())
+        {
+            model_file = base_dir / path / (path + ".egg");
+            if (!model_file.exists())
+                continue;
+        }
+
+        Entry entry;
+        entry.name = path;
+        entry.source_file = model_file;
+        entry.model_file = model_file;
+
+        const Filename thumbnail_file = base_dir / path / "thumbnail.png";
+        if (thumbnail_file.exists())
+            entry.thumbnail = TexturePool::load_texture(thumbnail_file);
+
+        const Filename animation_dir = base_dir / path / "animations";
+        vector_string clip_paths;
+        if (animation_dir.scan_directory(clip_paths))
+        {
+            for (const auto& clip_path: clip_paths)
+            {
+                const Filename clip_file = animation_dir / clip_path;
+                const std::string extension = clip_file.get_extension();
+                if (extension == "crclip" || extension == "bam" || extension == "egg")
+                    entry.clip_files.push_back(clip_file);
+            }
+        }
+
+        entries_.push_back(std::move(entry));
+    }
+
+    return entries_.size();
+}
+
+size_t AvatarLibrary::get_warm_memory() const
+{
+    return get_warm_memory({});
+}
+
+size_t AvatarLibrary::get_warm_memory(const std::vector<size_t>& excluded) const
+{
+    size_t bytes = 0;
+    std::unordered_set<const Texture*> counted;
+    for (size_t k = 0, k_end = entries_.size(); k < k_end; ++k)
+    {
+        const auto& entry = entries_[k];
+        if (!entry.actor || std::find(excluded.begin(), excluded.end(), k) != excluded.end())
+            continue;
+
+        bytes += entry.memory_bytes;
+        for (const auto& texture: entry.textures)
+        {
+            if (counted.insert(texture.p()).second)
+                bytes += texture->get_ram_image_size();
+        }
+    }
+    return bytes;
+}
+
+size_t AvatarLibrary::get_memory(size_t index) const
+{
+    const auto& entry = entries_[index];
+    size_t bytes = entry.memory_bytes;
+    for (const auto& texture: entry.textures)
+        bytes += texture->get_ram_image_size();
+    return bytes;
+}
+
+void AvatarLibrary::release_textures(size_t index)
+{
+    std::unordered_set<const Texture*> used;
+    for (size_t k = 0, k_end = entries_.size(); k < k_end; ++k)
+    {
+        if (k == index || !entries_[k].actor)
+            continue;
+        for (const auto& texture: entries_[k].textures)
+            used.insert(texture.p());
+    }
+
+    for (auto&& texture: entries_[index].textures)
+    {
+        if (used.find(texture.p()) == used.end())
+            TexturePool::release_texture(texture);
+    }
+    entries_[index].textures.clear();
+}
+
+std::vector<size_t> AvatarLibrary::select_evictions(size_t memory_cap, size_t keep) const
+{
+    std::vector<size_t> warm_entries;
+    for (size_t k = 0, k_end = entries_.size(); k < k_end; ++k)
+    {
+        if (entries_[k].actor && k != keep)
+            warm_entries.push_back(k);
+    }
+
+    std::sort(warm_entries.begin(), warm_entries.end(), [this](size_t lhs, size_t rhs) {
+        return entries_[lhs].last_used < entries_[rhs].last_used;
+    });
+
+    // shared textures are freed only with their last entry, so the memory is counted again.
+    std::vector<size_t> evictions;
+    for (const size_t index: warm_entries)
+    {
+        if (get_warm_memory(evictions) <= memory_cap)
+            break;
+
+        evictions.push_back(index);
+    }
+
+    return evictions;
+}
+
+size_t AvatarLibrary::estimate_memory(NodePath model, std::vector<PT(Texture)>& textures)
+{
+    // vertex arrays and primitives can be shared by geoms
+    std::unordered_set<const void*> counted;
+    size_t bytes = count_geometry(model, counted);
+
+    const TextureCollection model_textures = model.find_all_textures();
+    textures.clear();
+    for (int k = 0, k_end = model_textures.get_num_textures(); k < k_end; ++k)
+        textures.push_back(model_textures.get_texture(k));
+
+    bytes += count_joints(model);
+
+    return bytes;
+}
+
+size_t AvatarLibrary::estimate_unshared_memory(NodePath model, NodePath shared_model)
+{
+    std::unordered_set<const void*> counted;
+    count_geometry(shared_model, counted);
+
+    // a copy has its own part bundle, so all joints are counted.
+    return count_geometry(model, counted) + count_joints(model);
+}
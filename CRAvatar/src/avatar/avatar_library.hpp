@@ -0,0 +1,114 @@
+#pragma once
+
+#include <nodePath.h>
+#include <texture.h>
+
+#include <memory>
+
+namespace crsf {
+class TActorObject;
+class TAvatarMemoryObject;
+}
+
+class SkeletonIndex;
+class AnimatedBounds;
+class AnimationLayer;
+class AvatarMemoryLayout;
+
+/**
+ * Avatars in the avatar directory.
+ *
+ * Only metadata and thumbnails are loaded at startup, and actors are instantiated on demand.
+ * Instantiated (warm) actors are evicted in least recently used order to keep the memory cap.
+ */
+class AvatarLibrary
+{
+public:
+    struct Entry
+    {
+        std::string name;
+        Filename source_file;
+        Filename model_file;                            // cooked model if it exists
+        PT(Texture) thumbnail;
+        std::vector<Filename> clip_files;               // files in "<name>/animations"
+        std::shared_ptr<SkeletonIndex> skeleton;        // null until the model is cooked
+
+        std::shared_ptr<crsf::TActorObject> actor;      // null if it is not instantiated
+        std::shared_ptr<AnimationLayer> animation;      // null if joints are controlled by nodes
+        std::shared_ptr<AnimatedBounds> bounds;         // null if culling of the actor is disabled
+        std::shared_ptr<AvatarMemoryLayout> memory_layout;  // null until the memory object is created
+        crsf::TAvatarMemoryObject* memory_object = nullptr;
+        NodePath ik_target;                             // empty if the arm is not bound to the IK
+        bool loading = false;
+        size_t memory_bytes = 0;                        // estimated memory of the instantiated actor except textures
+        std::vector<PT(Texture)> textures;              // textures of the instantiated actor which may be shared
+        uint64_t last_used = 0;
+    };
+
+    /**
+     * Scan sub-directories which have "<name>/<name>.bam" (or .egg), optional "<name>/thumbnail.png"
+     * and animation clips in "<name>/animations" (.crclip, .bam or .egg).
+     */
+    size_t scan(const Filename& base_dir);
+
+    size_t size() const;
+    Entry& operator[](size_t index);
+    const Entry& operator[](size_t index) const;
+
+    /** Mark the entry as the most recently used. */
+    void touch(size_t index);
+
+    /** Memory of warm entries. Textures which are shared by entries are counted once. */
+    size_t get_warm_memory() const;
+
+    /** Memory of the warm entry including all of its textures. */
+    size_t get_memory(size_t index) const;
+
+    /** Release textures of the entry from the texture pool unless another warm entry uses them. */
+    void release_textures(size_t index);
+
+    /**
+     * Select warm entries in least recently used order until the memory of the rest fits in @a memory_cap.
+     * @param keep  Index of the entry which is never selected.
+     */
+    std::vector<size_t> select_evictions(size_t memory_cap, size_t keep) const;
+
+    /**
+     * Estimate memory of vertex data, primitives and joints of the model.
+     * Textures are collected in @a textures instead, because they are shared through the texture pool.
+     */
+    static size_t estimate_memory(NodePath model, std::vector<PT(Texture)>& textures);
+
+    /**
+     * Estimate memory of vertex data, primitives and joints of @a model which are not shared with @a shared_model,
+     * such as a copy of it. Textures are not counted.
+     */
+    static size_t estimate_unshared_memory(NodePath model, NodePath shared_model);
+
+private:
+    /** Memory of warm entries except @a excluded entries. */
+    size_t get_warm_memory(const std::vector<size_t>& excluded) const;
+
+    std::vector<Entry> entries_;
+    uint64_t tick_ = 0;
+};
+
+inline size_t AvatarLibrary::size() const
+{
+    return entries_.size();
+}
+
+inline auto AvatarLibrary::operator[](size_t index) -> Entry&
+{
+    return entries_[index];
+}
+
+inline auto AvatarLibrary::operator[](size_t index) const -> const Entry&
+{
+    return entries_[index];
+}
+
+inline void AvatarLibrary::touch(size_t index)
+{
+    entries_[index].last_used = ++tick_;
+}
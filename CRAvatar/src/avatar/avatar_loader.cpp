@@ -0,0 +1,76 @@
+#include "avatar/avatar_loader.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include <loader.h>
+#include <loaderOptions.h>
+#include <modelLoadRequest.h>
+#include <asyncTaskManager.h>
+
+AvatarLoader::AvatarLoader(int thread_count, const std::string& name, ThreadPriority priority)
+{
+    if (thread_count <= 0)
+        thread_count = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    chain_ = AsyncTaskManager::get_global_ptr()->make_task_chain(name);
+    chain_->set_num_threads(thread_count);
+    chain_->set_thread_priority(priority);
+}
+
+AvatarLoader::~AvatarLoader()
+{
+    for (auto&& req: requests_)
+        req.task->remove();
+    requests_.clear();
+
+    // the threads of the chain are stopped with the chain.
+    AsyncTaskManager::get_global_ptr()->remove_task_chain(chain_->get_name());
+}
+
+void AvatarLoader::request(const Filename& model_file, const Callback& callback)
+{
+    Loader* loader = Loader::get_global_ptr();
+
+    // models are not kept in the model pool, so that evicted avatars release their geometry.
+    const LoaderOptions options(LoaderOptions::LF_search | LoaderOptions::LF_report_errors | LoaderOptions::LF_no_ram_cache);
+
+    Request req;
+    req.task = loader->make_async_request(model_file, options);
+    req.task->set_task_chain(chain_->get_name());
+    req.callback = callback;
+    req.begin_time = std::chrono::steady_clock::now();
+
+    loader->load_async(req.task);
+
+    requests_.push_back(std::move(req));
+}
+
+void AvatarLoader::poll()
+{
+    for (auto iter = requests_.begin(); iter != requests_.end();)
+    {
+        ModelLoadRequest* model_request = DCAST(ModelLoadRequest, iter->task);
+        if (!model_request->is_ready())
+        {
+            ++iter;
+            continue;
+        }
+
+        Result result;
+        result.model_file = model_request->get_filename();
+        if (PandaNode* model = model_request->get_model())
+            result.model = NodePath(model);
+        result.decode_ms = model_request->get_dt() * 1000.0;
+        result.wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - iter->begin_time).count();
+
+        // callback may request new loading
+        Callback callback = std::move(iter->callback);
+        iter = requests_.erase(iter);
+        const auto index = std::distance(requests_.begin(), iter);
+
+        callback(result);
+
+        iter = requests_.begin() + index;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <nodePath.h>
+#include <asyncTaskChain.h>
+#include <threadPriority.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+/**
+ * Load model files of avatars on a pool of worker threads.
+ *
+ * Finished models are handed back to the main thread in poll(), so that actors can be created
+ * and attached to the scene there. Other models of the scene are loaded by another pool.
+ */
+class AvatarLoader
+{
+public:
+    struct Result
+    {
+        Filename model_file;
+        NodePath model;             // empty if loading is failed
+        double decode_ms;           // time of decoding on a worker
+        double wait_ms;             // time from request to hand-over
+    };
+
+    using Callback = std::function<void(const Result& result)>;
+
+    /**
+     * @param thread_count    The number of workers. If it is 0, the number of cores is used.
+     * @param name            Name of the task chain of workers.
+     */
+    AvatarLoader(int thread_count = 0, const std::string& name = "AvatarLoader", ThreadPriority priority = TP_low);
+    ~AvatarLoader();
+
+    void request(const Filename& model_file, const Callback& callback);
+
+    /** Call callbacks of finished requests. It should be called on the main thread. */
+    void poll();
+
+    bool is_busy() const;
+
+private:
+    struct Request
+    {
+        PT(AsyncTask) task;
+        Callback callback;
+        std::chrono::steady_clock::time_point begin_time;
+    };
+
+    AsyncTaskChain* chain_;
+    std::vector<Request> requests_;
+};
+
+inline bool AvatarLoader::is_busy() const
+{
+    return !requests_.empty();
+}
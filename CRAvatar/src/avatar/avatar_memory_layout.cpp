@@ -0,0 +1,50 @@
+#include "avatar/avatar_memory_layout.hpp"
+
+#include <crsf/CoexistenceInterface/TDynamicStageMemory.h>
+
+#include "avatar/skeleton_index.hpp"
+
+AvatarMemoryLayout::AvatarMemoryLayout(const SkeletonIndex& skeleton)
+{
+    joint_names_.reserve(skeleton.get_joint_count());
+    for (size_t k = 0, k_end = skeleton.get_joint_count(); k < k_end; ++k)
+        joint_names_.push_back(skeleton.get_joint(k).name);
+
+    build_slots();
+}
+
+AvatarMemoryLayout::AvatarMemoryLayout(NodePath model)
+{
+    // same order as the skeleton index which is cooked from the model
+    SkeletonIndex::collect_joint_names(model, joint_names_);
+
+    build_slots();
+}
+
+int AvatarMemoryLayout::find_slot(const std::string& name) const
+{
+    const auto iter = slots_.find(name);
+    return iter == slots_.end() ? -1 : iter->second;
+}
+
+crsf::TAvatarMemoryObject* AvatarMemoryLayout::create_memory_object(const std::string& name) const
+{
+    crsf::TCRProperty avatar_props;
+    avatar_props.m_strName = name;
+    avatar_props.m_propAvatar.SetJointNumber(static_cast<int>(joint_names_.size()));
+    return crsf::TDynamicStageMemory::GetInstance()->CreateAvatarMemoryObject(avatar_props);
+}
+
+void AvatarMemoryLayout::delete_memory_object(crsf::TAvatarMemoryObject* amo)
+{
+    if (amo)
+        crsf::TDynamicStageMemory::GetInstance()->DeleteAvatarMemoryObject(amo);
+}
+
+void AvatarMemoryLayout::build_slots()
+{
+    // the first joint wins if names are duplicated in characters
+    slots_.reserve(joint_names_.size());
+    for (size_t k = 0, k_end = joint_names_.size(); k < k_end; ++k)
+        slots_.emplace(joint_names_[k], static_cast<int>(k));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <nodePath.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class SkeletonIndex;
+
+namespace crsf {
+class TAvatarMemoryObject;
+}
+
+/**
+ * Slots of joints in the avatar memory object of an avatar.
+ *
+ * Slots follow the depth-first order of the skeleton index, so a joint has the same slot whenever
+ * the model is loaded, and the memory object has exactly one pose per joint of the rig.
+ */
+class AvatarMemoryLayout
+{
+public:
+    AvatarMemoryLayout(const SkeletonIndex& skeleton);
+
+    /** Layout of joints of all characters in @a model which is not cooked. */
+    AvatarMemoryLayout(NodePath model);
+
+    size_t get_joint_count() const;
+
+    /** Name of the joint of each slot. */
+    const std::vector<std::string>& get_joint_names() const;
+
+    /** @return Slot of the joint or -1. */
+    int find_slot(const std::string& name) const;
+
+    /** Create the avatar memory object with poses of all slots which are allocated once. */
+    crsf::TAvatarMemoryObject* create_memory_object(const std::string& name) const;
+
+    /** Delete the memory object which is created by create_memory_object(). */
+    static void delete_memory_object(crsf::TAvatarMemoryObject* amo);
+
+private:
+    void build_slots();
+
+    std::vector<std::string> joint_names_;
+    std::unordered_map<std::string, int> slots_;
+};
+
+// ************************************************************************************************
+
+inline size_t AvatarMemoryLayout::get_joint_count() const
+{
+    return joint_names_.size();
+}
+
+inline const std::vector<std::string>& AvatarMemoryLayout::get_joint_names() const
+{
+    return joint_names_;
+}
@@ -0,0 +1,111 @@
+#include "avatar/control_joints.hpp"
+
+#include <unordered_map>
+
+#include <character.h>
+#include <characterJoint.h>
+#include <modelNode.h>
+
+namespace {
+
+class ControlJointBuilder
+{
+public:
+    ControlJointBuilder(NodePath character_np, PartBundle* bundle,
+        const std::unordered_set<std::string>& driven_joints,
+        const std::unordered_set<std::string>& observed_joints):
+        character_np_(character_np), bundle_(bundle), driven_joints_(driven_joints), observed_joints_(observed_joints)
+    {
+    }
+
+    void build(PartGroup* part, NodePath parent_np, CharacterJoint* parent_joint)
+    {
+        if (part->is_of_type(CharacterJoint::get_class_type()))
+        {
+            CharacterJoint* joint = DCAST(CharacterJoint, part);
+            const std::string& name = joint->get_name();
+
+            if (driven_joints_.find(name) != driven_joints_.end())
+            {
+                if (parent_np.is_empty())
+                    parent_np = parent_joint ? expose(parent_joint) : character_np_;
+
+                PT(ModelNode) node = new ModelNode(name);
+                node->set_transform(TransformState::make_mat(joint->get_default_value()));
+                if (bundle_->control_joint(name, node))
+                {
+                    parent_np = parent_np.attach_new_node(node);
+                    ++node_count_;
+                }
+                else
+                {
+                    parent_np = NodePath();
+                }
+            }
+            else
+            {
+                if (observed_joints_.find(name) != observed_joints_.end())
+                    expose(joint);
+                parent_np = NodePath();
+            }
+
+            parent_joint = joint;
+        }
+
+        for (int k = 0, k_end = part->get_num_children(); k < k_end; ++k)
+            build(part->get_child(k), parent_np, parent_joint);
+    }
+
+    size_t get_node_count() const
+    {
+        return node_count_;
+    }
+
+private:
+    NodePath expose(CharacterJoint* joint)
+    {
+        auto iter = exposed_joints_.find(joint);
+        if (iter != exposed_joints_.end())
+            return iter->second;
+
+        // net transform is relative to the character node.
+        NodePath np = character_np_.attach_new_node(new ModelNode(joint->get_name()));
+        joint->add_net_transform(np.node());
+        ++node_count_;
+
+        return exposed_joints_.emplace(joint, np).first->second;
+    }
+
+    NodePath character_np_;
+    PartBundle* bundle_;
+    const std::unordered_set<std::string>& driven_joints_;
+    const std::unordered_set<std::string>& observed_joints_;
+
+    std::unordered_map<CharacterJoint*, NodePath> exposed_joints_;
+    size_t node_count_ = 0;
+};
+
+}
+
+size_t make_control_joints(NodePath actor_np,
+    const std::unordered_set<std::string>& driven_joints,
+    const std::unordered_set<std::string>& observed_joints)
+{
+    size_t node_count = 0;
+
+    const NodePathCollection characters = actor_np.find_all_matches("**/+Character");
+    for (int k = 0, k_end = characters.get_num_paths(); k < k_end; ++k)
+    {
+        NodePath character_np = characters.get_path(k);
+        Character* character = DCAST(Character, character_np.node());
+        for (int i = 0, i_end = character->get_num_bundles(); i < i_end; ++i)
+        {
+            PartBundle* bundle = character->get_bundle(i);
+            ControlJointBuilder builder(character_np, bundle, driven_joints, observed_joints);
+            builder.build(bundle, NodePath(), nullptr);
+            node_count += builder.get_node_count();
+        }
+    }
+
+    return node_count;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <nodePath.h>
+
+#include <string>
+#include <unordered_set>
+
+/**
+ * Create control joints only for driven joints instead of all joints of the characters.
+ *
+ * Driven joints become ModelNodes in their joint hierarchy which drive the local transforms.
+ * The topmost driven joint is attached to the exposed (read-only) net transform of its parent joint,
+ * so the driven joints still follow the animation of the other joints.
+ * Observed joints are only exposed, and the other joints are animated in the character.
+ *
+ * @return The number of created nodes.
+ */
+size_t make_control_joints(NodePath actor_np,
+    const std::unordered_set<std::string>& driven_joints,
+    const std::unordered_set<std::string>& observed_joints);
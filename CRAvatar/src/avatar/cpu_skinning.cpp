@@ -0,0 +1,331 @@
+#include "avatar/cpu_skinning.hpp"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <asyncTaskManager.h>
+#include <character.h>
+#include <genericAsyncTask.h>
+#include <geomNode.h>
+#include <geomVertexReader.h>
+#include <transformBlendTable.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRAVATAR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// vertices of a job. It is large enough to hide the cost of taking jobs.
+constexpr size_t job_size = 4096;
+
+}
+
+CpuSkinning::CpuSkinning(int thread_count): thread_count_(thread_count), next_job_(0)
+{
+    if (thread_count_ <= 0)
+        thread_count_ = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    // the caller takes jobs too
+    if (thread_count_ > 1)
+    {
+        chain_ = AsyncTaskManager::get_global_ptr()->make_task_chain("CpuSkinning-" + std::to_string(thread_count_));
+        chain_->set_num_threads(thread_count_ - 1);
+        chain_->set_thread_priority(TP_high);
+
+        for (int k = 1; k < thread_count_; ++k)
+        {
+            PT(AsyncTask) task = new GenericAsyncTask("CpuSkinning::run_jobs", [](GenericAsyncTask*, void* user_data) {
+                static_cast<CpuSkinning*>(user_data)->run_jobs();
+                return AsyncTask::DS_done;
+            }, this);
+            task->set_task_chain(chain_->get_name());
+            tasks_.push_back(task);
+        }
+    }
+}
+
+CpuSkinning::~CpuSkinning()
+{
+    clear();
+    tasks_.clear();
+
+    if (chain_)
+        AsyncTaskManager::get_global_ptr()->remove_task_chain(chain_->get_name());
+}
+
+size_t CpuSkinning::add_meshes(NodePath owner_np, bool render)
+{
+    size_t vertex_count = 0;
+
+    const NodePathCollection characters = owner_np.find_all_matches("**/+Character");
+    for (int c = 0, c_end = characters.get_num_paths(); c < c_end; ++c)
+    {
+        const NodePath character_np = characters.get_path(c);
+        const NodePathCollection geom_nps = character_np.find_all_matches("**/+GeomNode");
+        for (int i = 0, i_end = geom_nps.get_num_paths(); i < i_end; ++i)
+        {
+            GeomNode* geom_node = DCAST(GeomNode, geom_nps.get_path(i).node());
+            for (int g = 0, g_end = geom_node->get_num_geoms(); g < g_end; ++g)
+            {
+                CPT(GeomVertexData) source = geom_node->get_geom(g)->get_vertex_data();
+                const TransformBlendTable* table = source->get_transform_blend_table();
+                if (!table || source->get_format()->get_animation().get_animation_type() != GeomEnums::AT_panda)
+                    continue;
+
+                GeomVertexReader vertex(source, InternalName::get_vertex());
+                GeomVertexReader normal(source, InternalName::get_normal());
+                GeomVertexReader blend_index(source, InternalName::get_transform_blend());
+                if (!blend_index.has_column())
+                    continue;
+
+                Mesh mesh;
+                mesh.owner_np = owner_np;
+                mesh.character = DCAST(Character, character_np.node());
+
+                // unanimated copy which is written by the skinning
+                PT(GeomVertexFormat) format = new GeomVertexFormat(*source->get_format());
+                format->set_animation(GeomVertexAnimationSpec());
+                mesh.vertex_data = new GeomVertexData(*source);
+                mesh.vertex_data->set_format(GeomVertexFormat::register_format(format));
+                mesh.vertex_data->clear_transform_blend_table();
+
+                const GeomVertexFormat* target_format = mesh.vertex_data->get_format();
+                const GeomVertexColumn* column = nullptr;
+                if (!target_format->get_array_info(InternalName::get_vertex(), mesh.position_array, column) ||
+                    column->get_numeric_type() != GeomEnums::NT_float32 || column->get_num_components() < 3)
+                {
+                    continue;
+                }
+                mesh.position_offset = column->get_start();
+
+                mesh.has_normal = normal.has_column() &&
+                    target_format->get_array_info(InternalName::get_normal(), mesh.normal_array, column) &&
+                    column->get_numeric_type() == GeomEnums::NT_float32 && column->get_num_components() >= 3;
+                mesh.normal_offset = mesh.has_normal ? column->get_start() : 0;
+
+                // bind pose records with the largest influences
+                std::unordered_map<const VertexTransform*, uint16_t> palette_indices;
+                std::vector<std::pair<float, const VertexTransform*>> influences;
+                mesh.vertices.reserve(source->get_num_rows());
+                while (!vertex.is_at_end())
+                {
+                    Vertex v = {};
+                    const LVecBase3f pos = vertex.get_data3f();
+                    std::copy(pos.get_data(), pos.get_data() + 3, v.position);
+                    if (mesh.has_normal)
+                    {
+                        const LVecBase3f n = normal.get_data3f();
+                        std::copy(n.get_data(), n.get_data() + 3, v.normal);
+                    }
+
+                    const TransformBlend& blend = table->get_blend(blend_index.get_data1i());
+                    influences.clear();
+                    for (int t = 0, t_end = blend.get_num_transforms(); t < t_end; ++t)
+                    {
+                        if (blend.get_weight(t) > 0.0f)
+                            influences.emplace_back(blend.get_weight(t), blend.get_transform(t));
+                    }
+                    std::sort(influences.begin(), influences.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+                    influences.resize((std::min)(influences.size(), max_influences));
+
+                    float weight_sum = 0.0f;
+                    for (const auto& influence: influences)
+                        weight_sum += influence.first;
+
+                    for (size_t k = 0, k_end = influences.size(); k < k_end; ++k)
+                    {
+                        const auto result = palette_indices.emplace(influences[k].second, static_cast<uint16_t>(palette_indices.size()));
+                        v.joints[k] = result.first->second;
+                        v.weights[k] = influences[k].first / weight_sum;
+                    }
+
+                    mesh.vertices.push_back(v);
+                }
+
+                mesh.transforms.resize(palette_indices.size());
+                for (const auto& index: palette_indices)
+                    mesh.transforms[index.second] = index.first;
+                mesh.palette.resize(mesh.transforms.size() * 16);
+
+                if (render)
+                    geom_node->modify_geom(g)->set_vertex_data(mesh.vertex_data);
+
+                vertex_count += mesh.vertices.size();
+                meshes_.push_back(std::move(mesh));
+            }
+        }
+    }
+
+    build_jobs();
+
+    return vertex_count;
+}
+
+void CpuSkinning::remove_meshes(NodePath owner_np)
+{
+    meshes_.erase(std::remove_if(meshes_.begin(), meshes_.end(), [&](const Mesh& mesh) { return mesh.owner_np == owner_np; }),
+        meshes_.end());
+    build_jobs();
+}
+
+void CpuSkinning::clear()
+{
+    meshes_.clear();
+    jobs_.clear();
+}
+
+size_t CpuSkinning::get_vertex_count() const
+{
+    size_t count = 0;
+    for (const auto& mesh: meshes_)
+        count += mesh.vertices.size();
+    return count;
+}
+
+void CpuSkinning::update()
+{
+    // characters, palettes and vertex arrays are prepared on this thread, and workers only read and write memory.
+    LMatrix4f matrix;
+    for (auto&& mesh: meshes_)
+    {
+        mesh.position_data = nullptr;
+        mesh.normal_data = nullptr;
+        if (mesh.owner_np.is_hidden())
+            continue;
+
+        mesh.character->update();
+        for (size_t k = 0, k_end = mesh.transforms.size(); k < k_end; ++k)
+        {
+            mesh.transforms[k]->get_matrix(matrix);
+            std::copy(matrix.get_data(), matrix.get_data() + 16, &mesh.palette[k * 16]);
+        }
+
+        mesh.position_handle = mesh.vertex_data->modify_array_handle(mesh.position_array);
+        mesh.position_data = mesh.position_handle->get_write_pointer();
+        mesh.position_stride = mesh.position_handle->get_array_format()->get_stride();
+        if (mesh.has_normal)
+        {
+            mesh.normal_handle = mesh.normal_array == mesh.position_array ?
+                mesh.position_handle :
+                mesh.vertex_data->modify_array_handle(mesh.normal_array);
+            mesh.normal_data = mesh.normal_handle->get_write_pointer();
+            mesh.normal_stride = mesh.normal_handle->get_array_format()->get_stride();
+        }
+    }
+
+    active_jobs_.clear();
+    for (const auto& job: jobs_)
+    {
+        if (meshes_[job.mesh].position_data)
+            active_jobs_.push_back(job);
+    }
+
+    if (!active_jobs_.empty())
+    {
+        next_job_ = 0;
+
+        AsyncTaskManager* manager = AsyncTaskManager::get_global_ptr();
+        const size_t task_count = (std::min)(tasks_.size(), active_jobs_.size() - 1);
+        for (size_t k = 0; k < task_count; ++k)
+            manager->add(tasks_[k]);
+
+        run_jobs();
+
+        for (size_t k = 0; k < task_count; ++k)
+            tasks_[k]->wait();
+    }
+
+    for (auto&& mesh: meshes_)
+    {
+        mesh.position_handle.clear();
+        mesh.normal_handle.clear();
+    }
+}
+
+void CpuSkinning::build_jobs()
+{
+    jobs_.clear();
+    for (size_t k = 0, k_end = meshes_.size(); k < k_end; ++k)
+    {
+        const size_t vertex_count = meshes_[k].vertices.size();
+        for (size_t begin = 0; begin < vertex_count; begin += job_size)
+            jobs_.push_back({ k, begin, (std::min)(begin + job_size, vertex_count) });
+    }
+}
+
+void CpuSkinning::run_jobs()
+{
+    for (size_t k = next_job_++; k < active_jobs_.size(); k = next_job_++)
+        skin(active_jobs_[k]);
+}
+
+void CpuSkinning::skin(const Job& job)
+{
+    // blend matrices of influences, and transform the vertex with the blended matrix (row vectors).
+    const Mesh& mesh = meshes_[job.mesh];
+    const float* palette = mesh.palette.data();
+
+    for (size_t k = job.begin; k < job.end; ++k)
+    {
+        const Vertex& v = mesh.vertices[k];
+        float* position = reinterpret_cast<float*>(mesh.position_data + k * mesh.position_stride + mesh.position_offset);
+        float* normal = mesh.normal_data ?
+            reinterpret_cast<float*>(mesh.normal_data + k * mesh.normal_stride + mesh.normal_offset) :
+            nullptr;
+
+#ifdef CRAVATAR_USE_SSE2
+        const float* m = palette + v.joints[0] * 16;
+        __m128 w = _mm_set1_ps(v.weights[0]);
+        __m128 r0 = _mm_mul_ps(_mm_loadu_ps(m + 0), w);
+        __m128 r1 = _mm_mul_ps(_mm_loadu_ps(m + 4), w);
+        __m128 r2 = _mm_mul_ps(_mm_loadu_ps(m + 8), w);
+        __m128 r3 = _mm_mul_ps(_mm_loadu_ps(m + 12), w);
+        for (size_t i = 1; i < max_influences && v.weights[i] > 0.0f; ++i)
+        {
+            m = palette + v.joints[i] * 16;
+            w = _mm_set1_ps(v.weights[i]);
+            r0 = _mm_add_ps(r0, _mm_mul_ps(_mm_loadu_ps(m + 0), w));
+            r1 = _mm_add_ps(r1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+            r2 = _mm_add_ps(r2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+            r3 = _mm_add_ps(r3, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+        }
+
+        const __m128 p = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.position[0]), r0), _mm_mul_ps(_mm_set1_ps(v.position[1]), r1)),
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.position[2]), r2), r3));
+        _mm_storel_pi(reinterpret_cast<__m64*>(position), p);
+        _mm_store_ss(position + 2, _mm_movehl_ps(p, p));
+
+        if (normal)
+        {
+            const __m128 n = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v.normal[0]), r0), _mm_mul_ps(_mm_set1_ps(v.normal[1]), r1)),
+                _mm_mul_ps(_mm_set1_ps(v.normal[2]), r2));
+            _mm_storel_pi(reinterpret_cast<__m64*>(normal), n);
+            _mm_store_ss(normal + 2, _mm_movehl_ps(n, n));
+        }
+#else
+        float b[16];
+        const float* m = palette + v.joints[0] * 16;
+        for (int e = 0; e < 16; ++e)
+            b[e] = m[e] * v.weights[0];
+        for (size_t i = 1; i < max_influences && v.weights[i] > 0.0f; ++i)
+        {
+            m = palette + v.joints[i] * 16;
+            for (int e = 0; e < 16; ++e)
+                b[e] += m[e] * v.weights[i];
+        }
+
+        for (int col = 0; col < 3; ++col)
+        {
+            position[col] = v.position[0] * b[col] + v.position[1] * b[4 + col] + v.position[2] * b[8 + col] + b[12 + col];
+            if (normal)
+                normal[col] = v.normal[0] * b[col] + v.normal[1] * b[4 + col] + v.normal[2] * b[8 + col];
+        }
+#endif
+    }
+}
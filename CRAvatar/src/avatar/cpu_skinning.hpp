@@ -0,0 +1,107 @@
+#pragma once
+
+#include <nodePath.h>
+#include <asyncTaskChain.h>
+#include <geomVertexData.h>
+#include <geomVertexArrayData.h>
+#include <vertexTransform.h>
+
+#include <atomic>
+#include <vector>
+
+class Character;
+
+/**
+ * Linear blend skinning of character meshes on CPU worker threads.
+ *
+ * It is used instead of the single-threaded vertex animation of Panda3D when there is no GPU.
+ * Bind pose vertices are stored as records of a cache-friendly size which are read in order,
+ * and the vertices are split into jobs which write the vertex arrays of the meshes directly.
+ */
+class CpuSkinning
+{
+public:
+    static constexpr size_t max_influences = 4;
+
+    /** @param thread_count    The number of threads including the caller. If it is 0, the number of cores is used. */
+    CpuSkinning(int thread_count = 0);
+    ~CpuSkinning();
+
+    /**
+     * Add skinned meshes of characters under @a owner_np.
+     * @param render    Geometry is rendered with the skinned vertices instead of the animation of Panda3D.
+     * @return  The number of vertices added.
+     */
+    size_t add_meshes(NodePath owner_np, bool render);
+    void remove_meshes(NodePath owner_np);
+    void clear();
+
+    int get_thread_count() const;
+    size_t get_vertex_count() const;
+
+    /** Update characters of visible owners and skin their meshes. */
+    void update();
+
+private:
+    struct Vertex
+    {
+        float position[3];
+        float normal[3];
+        float weights[max_influences];          // sorted in descending order
+        uint16_t joints[max_influences];        // index in the palette of the mesh
+    };
+
+    struct Mesh
+    {
+        NodePath owner_np;
+        PT(Character) character;
+
+        std::vector<CPT(VertexTransform)> transforms;
+        std::vector<float> palette;             // row-major 4x4 matrices of transforms
+
+        std::vector<Vertex> vertices;
+        bool has_normal = false;
+
+        // unanimated copy which has the skinned vertices
+        PT(GeomVertexData) vertex_data;
+        int position_array = -1;
+        size_t position_offset = 0;
+        int normal_array = -1;
+        size_t normal_offset = 0;
+
+        // write pointers in the frame
+        PT(GeomVertexArrayDataHandle) position_handle;
+        PT(GeomVertexArrayDataHandle) normal_handle;
+        unsigned char* position_data = nullptr;
+        size_t position_stride = 0;
+        unsigned char* normal_data = nullptr;
+        size_t normal_stride = 0;
+    };
+
+    struct Job
+    {
+        size_t mesh;
+        size_t begin;
+        size_t end;
+    };
+
+    void build_jobs();
+    void run_jobs();
+    void skin(const Job& job);
+
+    int thread_count_;
+    AsyncTaskChain* chain_ = nullptr;
+    std::vector<PT(AsyncTask)> tasks_;         // a task per worker which is added in each update
+
+    std::vector<Mesh> meshes_;
+    std::vector<Job> jobs_;
+    std::vector<Job> active_jobs_;
+    std::atomic<size_t> next_job_;
+};
+
+// ************************************************************************************************
+
+inline int CpuSkinning::get_thread_count() const
+{
+    return thread_count_;
+}
@@ -0,0 +1,134 @@
+#include "avatar/crowd.hpp"
+
+#include <cmath>
+#include <unordered_set>
+
+#include <fmt/format.h>
+
+#include <character.h>
+
+#include "avatar/avatar_library.hpp"
+#include "avatar/avatar_memory_layout.hpp"
+#include "avatar/skeleton_index.hpp"
+#include "avatar/skeleton_pose.hpp"
+
+namespace {
+
+// H-Anim joints which sway in the idle animation
+const std::unordered_set<std::string> idle_joint_names = { "vl1", "vc7", "skullbase", "l_shoulder", "r_shoulder" };
+
+}
+
+Crowd::Crowd(NodePath parent, float spacing): spacing_(spacing)
+{
+    root_ = parent.attach_new_node("Crowd");
+}
+
+Crowd::~Crowd()
+{
+    clear();
+    root_.remove_node();
+}
+
+void Crowd::add_instances(const std::string& name, NodePath prototype, const std::shared_ptr<SkeletonIndex>& skeleton, size_t count)
+{
+    if (prototype.is_empty() || count == 0)
+        return;
+
+    if (skeleton)
+        skeletons_.push_back(skeleton);
+
+    // topology and bind pose are built once, and poses of instances share them.
+    std::unique_ptr<SkeletonPose> bind_pose;
+    std::vector<size_t> animated_joints;
+    if (skeleton)
+    {
+        bind_pose = std::make_unique<SkeletonPose>(*skeleton);
+        for (size_t k = 0, k_end = bind_pose->get_joint_count(); k < k_end; ++k)
+        {
+            if (idle_joint_names.find(bind_pose->get_name(k)) != idle_joint_names.end())
+                animated_joints.push_back(k);
+        }
+    }
+
+    const AvatarMemoryLayout memory_layout = skeleton ? AvatarMemoryLayout(*skeleton) : AvatarMemoryLayout(prototype);
+
+    const size_t columns = 20;
+    for (size_t k = 0; k < count; ++k)
+    {
+        const size_t slot = instances_.size();
+
+        Instance instance;
+        instance.np = prototype.copy_to(root_);         // vertex arrays are shared by copies
+        instance.np.set_scale(0.01f);                   // unit is cm
+        instance.np.set_pos(
+            (static_cast<float>(slot % columns) - columns / 2.0f) * spacing_,
+            -(static_cast<float>(slot / columns) + 2.0f) * spacing_,
+            0);
+        instance.phase = static_cast<float>(slot) * 0.37f;
+
+        if (bind_pose)
+        {
+            instance.pose = std::make_unique<SkeletonPose>(*bind_pose);
+            instance.animated_joints = animated_joints;
+
+            const NodePath character_np = instance.np.find("**/+Character");
+            if (!character_np.is_empty())
+                instance.pose->bind(DCAST(Character, character_np.node()), idle_joint_names);
+        }
+
+        instance.memory_bytes = AvatarLibrary::estimate_unshared_memory(instance.np, prototype);
+        if (instance.pose)
+            instance.memory_bytes += instance.pose->get_memory();
+
+        instance.memory_object = memory_layout.create_memory_object(fmt::format("{}-crowd-{}", name, slot));
+
+        instances_.push_back(std::move(instance));
+    }
+}
+
+void Crowd::update(double time)
+{
+    for (auto&& instance: instances_)
+    {
+        if (!instance.pose)
+            continue;
+
+        const float angle = 5.0f * std::sin(static_cast<float>(time) * 1.5f + instance.phase);
+        LQuaternionf sway;
+        sway.set_hpr(LVecBase3f(0, 0, angle));
+
+        instance.pose->reset();
+        for (const size_t k: instance.animated_joints)
+            instance.pose->set_local_quat(k, sway * instance.pose->get_local_quat(k));
+        instance.pose->build_local_matrices();
+    }
+}
+
+void Crowd::publish()
+{
+    for (auto&& instance: instances_)
+    {
+        if (instance.pose)
+            instance.pose->publish();
+    }
+}
+
+size_t Crowd::get_instance_memory() const
+{
+    size_t bytes = 0;
+    for (const auto& instance: instances_)
+        bytes += instance.memory_bytes;
+    return bytes;
+}
+
+void Crowd::clear()
+{
+    for (auto&& instance: instances_)
+    {
+        AvatarMemoryLayout::delete_memory_object(instance.memory_object);
+        instance.np.remove_node();
+    }
+    instances_.clear();
+    skeletons_.clear();
+}
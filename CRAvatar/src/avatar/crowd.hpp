@@ -0,0 +1,64 @@
+#pragma once
+
+#include <nodePath.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class SkeletonIndex;
+class SkeletonPose;
+
+namespace crsf {
+class TAvatarMemoryObject;
+}
+
+/**
+ * Instances of avatars which share geometry, skeleton topology and bind pose of their prototype.
+ *
+ * Copies of a Character share vertex arrays and textures of the prototype, and poses share the topology
+ * and the bind pose. Each instance owns only its part bundle, the pose buffer and an avatar memory object.
+ */
+class Crowd
+{
+public:
+    Crowd(NodePath parent, float spacing = 0.8f);
+    ~Crowd();
+
+    /** Add @a count instances of the prototype model. Its unit is cm like actors. */
+    void add_instances(const std::string& name, NodePath prototype, const std::shared_ptr<SkeletonIndex>& skeleton, size_t count);
+
+    /** Animate instances with phase offsets. It touches only the poses, so it can run on a worker thread. */
+    void update(double time);
+
+    /** Write the poses to the characters. Characters share data of the prototype, so it runs on the main thread. */
+    void publish();
+
+    size_t size() const;
+
+    /** Memory owned by instances, which is measured excluding data shared with prototypes. */
+    size_t get_instance_memory() const;
+
+    void clear();
+
+private:
+    struct Instance
+    {
+        NodePath np;
+        std::unique_ptr<SkeletonPose> pose;
+        std::vector<size_t> animated_joints;
+        float phase;
+        crsf::TAvatarMemoryObject* memory_object;
+        size_t memory_bytes;        // geometry and joints not shared with the prototype, and the pose
+    };
+
+    NodePath root_;
+    float spacing_;
+    std::vector<std::shared_ptr<SkeletonIndex>> skeletons_;     // keep mapped while instances use them
+    std::vector<Instance> instances_;
+};
+
+inline size_t Crowd::size() const
+{
+    return instances_.size();
+}
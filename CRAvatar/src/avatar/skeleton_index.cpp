@@ -0,0 +1,187 @@
+#include "avatar/skeleton_index.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <character.h>
+#include <characterJoint.h>
+
+extern spdlog::logger* global_logger;
+
+namespace {
+
+constexpr char skeleton_index_magic[4] = { 'C', 'R', 'S', 'K' };
+
+struct PartJoint
+{
+    const CharacterJoint* joint;
+    int32_t parent;
+};
+
+void collect_part_joints(const PartGroup* part, int32_t parent, std::vector<PartJoint>& joints)
+{
+    // bundles and groups are skipped, and their children are attached to the nearest joint.
+    if (part->is_of_type(CharacterJoint::get_class_type()))
+    {
+        joints.push_back({ DCAST(CharacterJoint, part), parent });
+        parent = static_cast<int32_t>(joints.size() - 1);
+    }
+
+    for (int k = 0, k_end = part->get_num_children(); k < k_end; ++k)
+        collect_part_joints(part->get_child(k), parent, joints);
+}
+
+void collect_character_joints(NodePath model, std::vector<PartJoint>& joints)
+{
+    const NodePathCollection characters = model.find_all_matches("**/+Character");
+    for (int k = 0, k_end = characters.get_num_paths(); k < k_end; ++k)
+    {
+        const Character* character = DCAST(Character, characters.get_path(k).node());
+        for (int i = 0, i_end = character->get_num_bundles(); i < i_end; ++i)
+            collect_part_joints(character->get_bundle(i), -1, joints);
+    }
+}
+
+}
+
+bool SkeletonIndex::collect_joints(NodePath model, std::vector<Joint>& joints)
+{
+    std::vector<PartJoint> part_joints;
+    collect_character_joints(model, part_joints);
+
+    joints.reserve(joints.size() + part_joints.size());
+    for (const auto& part_joint: part_joints)
+    {
+        // names are not truncated, so that they are not confused with other joints.
+        const std::string& name = part_joint.joint->get_name();
+        if (name.length() > max_name_length)
+        {
+            global_logger->warn("Joint name is longer than {} characters: {}", max_name_length, name);
+            return false;
+        }
+
+        Joint data = {};
+        std::memcpy(data.name, name.c_str(), name.length());
+        data.parent = part_joint.parent;
+
+        const LMatrix4f bind_pose = LCAST(float, part_joint.joint->get_default_value());
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int col = 0; col < 4; ++col)
+                data.bind_pose[row * 4 + col] = bind_pose(row, col);
+        }
+
+        joints.push_back(data);
+    }
+
+    return true;
+}
+
+void SkeletonIndex::collect_joint_names(NodePath model, std::vector<std::string>& names)
+{
+    std::vector<PartJoint> part_joints;
+    collect_character_joints(model, part_joints);
+
+    names.reserve(names.size() + part_joints.size());
+    for (const auto& part_joint: part_joints)
+        names.push_back(part_joint.joint->get_name());
+}
+
+bool SkeletonIndex::write(const Filename& file, const HashVal& source_hash, NodePath model)
+{
+    std::vector<Joint> joints;
+    if (!collect_joints(model, joints))
+        return false;
+
+    Header header = {};
+    std::memcpy(header.magic, skeleton_index_magic, sizeof(header.magic));
+    header.version = version;
+    for (int k = 0; k < 4; ++k)
+        header.source_hash[k] = source_hash.get_value(k);
+    header.joint_count = static_cast<uint32_t>(joints.size());
+
+    Filename(file).make_dir();
+
+    std::ofstream ofs(file.to_os_specific(), std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        return false;
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(joints.data()), joints.size() * sizeof(Joint));
+
+    return ofs.good();
+}
+
+SkeletonIndex::SkeletonIndex() = default;
+
+SkeletonIndex::~SkeletonIndex() = default;
+
+bool SkeletonIndex::open(const Filename& file)
+{
+    close();
+
+    if (!file.exists())
+        return false;
+
+    try
+    {
+        mapping_ = std::make_unique<boost::interprocess::file_mapping>(file.to_os_specific().c_str(), boost::interprocess::read_only);
+        region_ = std::make_unique<boost::interprocess::mapped_region>(*mapping_, boost::interprocess::read_only);
+    }
+    catch (const boost::interprocess::interprocess_exception&)
+    {
+        close();
+        return false;
+    }
+
+    const auto* header = static_cast<const Header*>(region_->get_address());
+    if (region_->get_size() < sizeof(Header) ||
+        std::memcmp(header->magic, skeleton_index_magic, sizeof(header->magic)) != 0 ||
+        header->version != version ||
+        region_->get_size() < sizeof(Header) + header->joint_count * sizeof(Joint))
+    {
+        close();
+        return false;
+    }
+
+    header_ = header;
+    joints_ = reinterpret_cast<const Joint*>(header + 1);
+
+    return true;
+}
+
+void SkeletonIndex::close()
+{
+    header_ = nullptr;
+    joints_ = nullptr;
+    region_.reset();
+    mapping_.reset();
+}
+
+bool SkeletonIndex::is_valid_for(const HashVal& source_hash) const
+{
+    if (!header_)
+        return false;
+
+    for (int k = 0; k < 4; ++k)
+    {
+        if (header_->source_hash[k] != source_hash.get_value(k))
+            return false;
+    }
+    return true;
+}
+
+int SkeletonIndex::find_joint(const std::string& name) const
+{
+    for (size_t k = 0, k_end = get_joint_count(); k < k_end; ++k)
+    {
+        if (name.compare(joints_[k].name) == 0)
+            return static_cast<int>(k);
+    }
+    return -1;
+}
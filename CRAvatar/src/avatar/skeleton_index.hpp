@@ -0,0 +1,110 @@
+#pragma once
+
+#include <nodePath.h>
+#include <hashVal.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace boost {
+namespace interprocess {
+class file_mapping;
+class mapped_region;
+}
+}
+
+/**
+ * Joint hierarchy and bind poses of a skeleton in a flat binary file.
+ *
+ * Joints are stored in depth-first order, so that the parent of a joint always comes before it.
+ * The file is memory-mapped and read in place.
+ */
+class SkeletonIndex
+{
+public:
+    static constexpr uint32_t version = 1;
+    static constexpr size_t max_name_length = 47;
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t source_hash[4];        // content hash of the source model
+        uint32_t joint_count;
+        uint32_t reserved;
+    };
+
+    struct Joint
+    {
+        char name[max_name_length + 1];
+        int32_t parent;                 // -1 for root joints
+        float bind_pose[16];            // local transform (row-major LMatrix4f)
+    };
+
+    /**
+     * Collect joints of all characters in @a model in depth-first order.
+     * @return false if a name of the joints is longer than max_name_length.
+     */
+    static bool collect_joints(NodePath model, std::vector<Joint>& joints);
+
+    /** Collect full names of joints in the same order as collect_joints(). */
+    static void collect_joint_names(NodePath model, std::vector<std::string>& names);
+
+    /**
+     * Collect joints of all characters in @a model and write them to @a file.
+     * It fails if a name of the joints does not fit, so the model is used without the index.
+     */
+    static bool write(const Filename& file, const HashVal& source_hash, NodePath model);
+
+    SkeletonIndex();
+    ~SkeletonIndex();
+
+    bool open(const Filename& file);
+    void close();
+
+    bool is_open() const;
+    bool is_valid_for(const HashVal& source_hash) const;
+
+    size_t get_joint_count() const;
+    const Joint& get_joint(size_t index) const;
+
+    /** @return Index of the joint or -1. */
+    int find_joint(const std::string& name) const;
+
+    LMatrix4f get_bind_pose(size_t index) const;
+
+private:
+    std::unique_ptr<boost::interprocess::file_mapping> mapping_;
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+
+    const Header* header_ = nullptr;
+    const Joint* joints_ = nullptr;
+};
+
+// ************************************************************************************************
+
+inline bool SkeletonIndex::is_open() const
+{
+    return header_ != nullptr;
+}
+
+inline size_t SkeletonIndex::get_joint_count() const
+{
+    return header_ ? header_->joint_count : 0;
+}
+
+inline auto SkeletonIndex::get_joint(size_t index) const -> const Joint&
+{
+    return joints_[index];
+}
+
+inline LMatrix4f SkeletonIndex::get_bind_pose(size_t index) const
+{
+    const float* m = joints_[index].bind_pose;
+    return LMatrix4f(
+        m[0], m[1], m[2], m[3],
+        m[4], m[5], m[6], m[7],
+        m[8], m[9], m[10], m[11],
+        m[12], m[13], m[14], m[15]);
+}
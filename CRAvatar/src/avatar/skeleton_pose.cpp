@@ -0,0 +1,313 @@
+#include "avatar/skeleton_pose.hpp"
+
+#include <algorithm>
+
+#include <character.h>
+#include <characterJoint.h>
+#include <modelNode.h>
+#include <transformState.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRAVATAR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "avatar/skeleton_index.hpp"
+
+SkeletonPose::SkeletonPose(const SkeletonIndex& skeleton): joint_count_(skeleton.get_joint_count())
+{
+    const size_t padded_size = (joint_count_ + lane_count - 1) / lane_count * lane_count;
+
+    // padding lanes are identity transforms
+    for (auto* v: { &tx_, &ty_, &tz_, &qx_, &qy_, &qz_ })
+        v->resize(padded_size, 0.0f);
+    for (auto* v: { &qw_, &sx_, &sy_, &sz_ })
+        v->resize(padded_size, 1.0f);
+
+    local_.resize(padded_size * 16);
+    world_.resize(padded_size * 16);
+
+    auto shared = std::make_shared<Skeleton>();
+    shared->parents.reserve(joint_count_);
+    shared->names.reserve(joint_count_);
+    shared->bind_pos.reserve(joint_count_);
+    shared->bind_quat.reserve(joint_count_);
+    shared->bind_scale.reserve(joint_count_);
+    for (size_t k = 0; k < joint_count_; ++k)
+    {
+        shared->parents.push_back(skeleton.get_joint(k).parent);
+        shared->names.push_back(skeleton.get_joint(k).name);
+
+        CPT(TransformState) bind_pose = TransformState::make_mat(skeleton.get_bind_pose(k));
+        shared->bind_pos.push_back(bind_pose->get_pos());
+        shared->bind_quat.push_back(bind_pose->get_norm_quat());
+        shared->bind_scale.push_back(bind_pose->get_scale());
+    }
+    skeleton_ = std::move(shared);
+
+    reset();
+    compute_world();
+}
+
+void SkeletonPose::reset()
+{
+    for (size_t k = 0; k < joint_count_; ++k)
+    {
+        set_local_pos(k, skeleton_->bind_pos[k]);
+        set_local_quat(k, skeleton_->bind_quat[k]);
+        set_local_scale(k, skeleton_->bind_scale[k]);
+    }
+}
+
+void SkeletonPose::compute_world()
+{
+    build_local_matrices();
+    concatenate();
+}
+
+void SkeletonPose::build_local_matrices()
+{
+    // see LQuaternionf::extract_to_matrix. Rows are scaled axes and the last row is translation.
+    const size_t padded_size = qw_.size();
+
+#ifdef CRAVATAR_USE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    for (size_t k = 0; k < padded_size; k += lane_count)
+    {
+        const __m128 x = _mm_loadu_ps(&qx_[k]);
+        const __m128 y = _mm_loadu_ps(&qy_[k]);
+        const __m128 z = _mm_loadu_ps(&qz_[k]);
+        const __m128 w = _mm_loadu_ps(&qw_[k]);
+
+        const __m128 xs = _mm_mul_ps(x, two);
+        const __m128 ys = _mm_mul_ps(y, two);
+        const __m128 zs = _mm_mul_ps(z, two);
+        const __m128 wx = _mm_mul_ps(w, xs);
+        const __m128 wy = _mm_mul_ps(w, ys);
+        const __m128 wz = _mm_mul_ps(w, zs);
+        const __m128 xx = _mm_mul_ps(x, xs);
+        const __m128 xy = _mm_mul_ps(x, ys);
+        const __m128 xz = _mm_mul_ps(x, zs);
+        const __m128 yy = _mm_mul_ps(y, ys);
+        const __m128 yz = _mm_mul_ps(y, zs);
+        const __m128 zz = _mm_mul_ps(z, zs);
+
+        const __m128 sx = _mm_loadu_ps(&sx_[k]);
+        const __m128 sy = _mm_loadu_ps(&sy_[k]);
+        const __m128 sz = _mm_loadu_ps(&sz_[k]);
+
+        __m128 r0 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+        __m128 r1 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+        __m128 r2 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+        __m128 r3 = zero;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&local_[(k + 0) * 16 + 0], r0);
+        _mm_storeu_ps(&local_[(k + 1) * 16 + 0], r1);
+        _mm_storeu_ps(&local_[(k + 2) * 16 + 0], r2);
+        _mm_storeu_ps(&local_[(k + 3) * 16 + 0], r3);
+
+        r0 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+        r1 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+        r2 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+        r3 = zero;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&local_[(k + 0) * 16 + 4], r0);
+        _mm_storeu_ps(&local_[(k + 1) * 16 + 4], r1);
+        _mm_storeu_ps(&local_[(k + 2) * 16 + 4], r2);
+        _mm_storeu_ps(&local_[(k + 3) * 16 + 4], r3);
+
+        r0 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+        r1 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+        r2 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+        r3 = zero;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&local_[(k + 0) * 16 + 8], r0);
+        _mm_storeu_ps(&local_[(k + 1) * 16 + 8], r1);
+        _mm_storeu_ps(&local_[(k + 2) * 16 + 8], r2);
+        _mm_storeu_ps(&local_[(k + 3) * 16 + 8], r3);
+
+        r0 = _mm_loadu_ps(&tx_[k]);
+        r1 = _mm_loadu_ps(&ty_[k]);
+        r2 = _mm_loadu_ps(&tz_[k]);
+        r3 = one;
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(&local_[(k + 0) * 16 + 12], r0);
+        _mm_storeu_ps(&local_[(k + 1) * 16 + 12], r1);
+        _mm_storeu_ps(&local_[(k + 2) * 16 + 12], r2);
+        _mm_storeu_ps(&local_[(k + 3) * 16 + 12], r3);
+    }
+#else
+    for (size_t k = 0; k < padded_size; ++k)
+    {
+        const float xs = qx_[k] * 2.0f;
+        const float ys = qy_[k] * 2.0f;
+        const float zs = qz_[k] * 2.0f;
+        const float wx = qw_[k] * xs, wy = qw_[k] * ys, wz = qw_[k] * zs;
+        const float xx = qx_[k] * xs, xy = qx_[k] * ys, xz = qx_[k] * zs;
+        const float yy = qy_[k] * ys, yz = qy_[k] * zs, zz = qz_[k] * zs;
+
+        float* m = &local_[k * 16];
+        m[0] = (1.0f - (yy + zz)) * sx_[k]; m[1] = (xy + wz) * sx_[k];          m[2] = (xz - wy) * sx_[k];          m[3] = 0.0f;
+        m[4] = (xy - wz) * sy_[k];          m[5] = (1.0f - (xx + zz)) * sy_[k]; m[6] = (yz + wx) * sy_[k];          m[7] = 0.0f;
+        m[8] = (xz + wy) * sz_[k];          m[9] = (yz - wx) * sz_[k];          m[10] = (1.0f - (xx + yy)) * sz_[k]; m[11] = 0.0f;
+        m[12] = tx_[k];                     m[13] = ty_[k];                     m[14] = tz_[k];                     m[15] = 1.0f;
+    }
+#endif
+
+    local_dirty_ = false;
+}
+
+void SkeletonPose::concatenate()
+{
+    // world = local * world of parent (row vectors). Parents always come before children.
+    for (size_t k = 0; k < joint_count_; ++k)
+    {
+        const float* l = &local_[k * 16];
+        float* m = &world_[k * 16];
+
+        const int32_t parent = skeleton_->parents[k];
+        if (parent < 0)
+        {
+            std::copy(l, l + 16, m);
+            continue;
+        }
+
+        const float* p = &world_[parent * 16];
+
+#ifdef CRAVATAR_USE_SSE2
+        const __m128 p0 = _mm_loadu_ps(p + 0);
+        const __m128 p1 = _mm_loadu_ps(p + 4);
+        const __m128 p2 = _mm_loadu_ps(p + 8);
+        const __m128 p3 = _mm_loadu_ps(p + 12);
+
+        for (int row = 0; row < 4; ++row)
+        {
+            const float* lr = l + row * 4;
+            __m128 r = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(lr[0]), p0), _mm_mul_ps(_mm_set1_ps(lr[1]), p1)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(lr[2]), p2), _mm_mul_ps(_mm_set1_ps(lr[3]), p3)));
+            _mm_storeu_ps(m + row * 4, r);
+        }
+#else
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int col = 0; col < 4; ++col)
+            {
+                m[row * 4 + col] =
+                    l[row * 4 + 0] * p[0 + col] +
+                    l[row * 4 + 1] * p[4 + col] +
+                    l[row * 4 + 2] * p[8 + col] +
+                    l[row * 4 + 3] * p[12 + col];
+            }
+        }
+#endif
+    }
+}
+
+size_t SkeletonPose::bind(Character* character, const std::unordered_set<std::string>& joint_names)
+{
+    unbind();
+
+    if (!character)
+        return 0;
+
+    for (size_t k = 0; k < joint_count_; ++k)
+    {
+        const std::string& name = skeleton_->names[k];
+        if (joint_names.find(name) == joint_names.end())
+            continue;
+
+        for (int i = 0, i_end = character->get_num_bundles(); i < i_end; ++i)
+        {
+            PartBundle* bundle = character->get_bundle(i);
+            PartGroup* part = bundle->find_child(name);
+            if (!part || !part->is_of_type(CharacterJoint::get_class_type()))
+                continue;
+
+            // control_joint() needs a node, but the channel is driven by values after that.
+            CharacterJoint* joint = DCAST(CharacterJoint, part);
+            PT(ModelNode) node = new ModelNode(name);
+            node->set_transform(TransformState::make_mat(joint->get_default_value()));
+            if (!bundle->control_joint(name, node))
+                continue;
+
+            PT(AnimChannelMatrixDynamic) channel = DCAST(AnimChannelMatrixDynamic, joint->get_forced_channel());
+            channel->set_value_node(nullptr);
+
+            bindings_.push_back({ k, channel, false });
+            break;
+        }
+    }
+
+    return bindings_.size();
+}
+
+void SkeletonPose::unbind()
+{
+    bindings_.clear();
+    published_count_ = 0;
+    skipped_count_ = 0;
+}
+
+void SkeletonPose::publish()
+{
+    if (local_dirty_)
+        build_local_matrices();
+
+    // a new value invalidates cached transforms and the skinning of the character, so unchanged joints are skipped.
+    published_count_ = 0;
+    skipped_count_ = 0;
+    for (auto&& binding: bindings_)
+    {
+        const size_t k = binding.index;
+        const LVecBase3f pos(tx_[k], ty_[k], tz_[k]);
+        const LQuaternionf quat(qw_[k], qx_[k], qy_[k], qz_[k]);
+        const LVecBase3f scale(sx_[k], sy_[k], sz_[k]);
+
+        if (binding.published &&
+            binding.pos.almost_equal(pos, publish_epsilon) &&
+            binding.quat.almost_equal(quat, publish_epsilon) &&
+            binding.scale.almost_equal(scale, publish_epsilon))
+        {
+            ++skipped_count_;
+            continue;
+        }
+
+        const float* m = &local_[k * 16];
+        binding.channel->set_value(LMatrix4f(
+            m[0], m[1], m[2], m[3],
+            m[4], m[5], m[6], m[7],
+            m[8], m[9], m[10], m[11],
+            m[12], m[13], m[14], m[15]));
+        binding.published = true;
+        binding.pos = pos;
+        binding.quat = quat;
+        binding.scale = scale;
+        ++published_count_;
+    }
+}
+
+size_t SkeletonPose::get_memory() const
+{
+    size_t bytes = sizeof(SkeletonPose);
+    for (const auto* buffer: { &tx_, &ty_, &tz_, &qx_, &qy_, &qz_, &qw_, &sx_, &sy_, &sz_, &local_, &world_ })
+        bytes += buffer->capacity() * sizeof(float);
+    bytes += bindings_.capacity() * sizeof(Binding) + bindings_.size() * sizeof(AnimChannelMatrixDynamic);
+    return bytes;
+}
+
+size_t SkeletonPose::get_shared_memory() const
+{
+    size_t bytes = sizeof(Skeleton);
+    bytes += skeleton_->parents.capacity() * sizeof(int32_t);
+    bytes += skeleton_->names.capacity() * sizeof(std::string);
+    for (const auto& name: skeleton_->names)
+        bytes += name.capacity();
+    bytes += skeleton_->bind_pos.capacity() * sizeof(LVecBase3f);
+    bytes += skeleton_->bind_quat.capacity() * sizeof(LQuaternionf);
+    bytes += skeleton_->bind_scale.capacity() * sizeof(LVecBase3f);
+    return bytes;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <luse.h>
+#include <animChannelMatrixDynamic.h>
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class Character;
+class SkeletonIndex;
+
+/**
+ * Local transforms of a skeleton in SoA layout and their world (character space) matrices.
+ *
+ * Joints are in the topological order of the skeleton index, so world matrices of the whole skeleton
+ * are computed in one pass. Local transforms of bound joints are published to the character directly
+ * without scene graph nodes.
+ *
+ * Topology and bind pose are immutable and shared by copies, so a copy owns only its transforms and bindings.
+ */
+class SkeletonPose
+{
+public:
+    static constexpr size_t lane_count = 4;
+
+    /** Bound joints whose local transforms differ less than this from the last published ones are not written. */
+    static constexpr float publish_epsilon = 1e-4f;
+
+    SkeletonPose(const SkeletonIndex& skeleton);
+
+    size_t get_joint_count() const;
+    int get_parent(size_t index) const;
+    const std::string& get_name(size_t index) const;
+
+    LVecBase3f get_local_pos(size_t index) const;
+    LQuaternionf get_local_quat(size_t index) const;
+
+    void set_local_pos(size_t index, const LVecBase3f& pos);
+    void set_local_quat(size_t index, const LQuaternionf& quat);
+    void set_local_scale(size_t index, const LVecBase3f& scale);
+
+    /** Restore the bind pose. */
+    void reset();
+
+    /** Compute world matrices of all joints from local transforms. */
+    void compute_world();
+
+    /** Build local matrices of all joints without world matrices. It does not touch the character. */
+    void build_local_matrices();
+
+    LMatrix4f get_world(size_t index) const;
+    LPoint3f get_world_pos(size_t index) const;
+
+    /**
+     * Take control of the joints of @a character to publish local transforms to them.
+     * @return  The number of bound joints.
+     */
+    size_t bind(Character* character, const std::unordered_set<std::string>& joint_names);
+    void unbind();
+
+    /**
+     * Write local matrices of bound joints which are changed since the last publish to the character.
+     * Local matrices are built in the SIMD pass unless compute_world() has built them.
+     */
+    void publish();
+
+    /** The number of bound joints which are written or skipped in the last publish. */
+    size_t get_published_count() const;
+    size_t get_skipped_count() const;
+
+    /** Memory of the buffers and the channels of bound joints which the pose owns, excluding the shared skeleton. */
+    size_t get_memory() const;
+
+    /** Memory of the topology and the bind pose which are shared by copies. */
+    size_t get_shared_memory() const;
+
+private:
+    struct Skeleton
+    {
+        std::vector<int32_t> parents;
+        std::vector<std::string> names;
+        std::vector<LVecBase3f> bind_pos;
+        std::vector<LQuaternionf> bind_quat;
+        std::vector<LVecBase3f> bind_scale;
+    };
+
+    void concatenate();
+
+    size_t joint_count_;
+    std::shared_ptr<const Skeleton> skeleton_;
+
+    // padded to multiple of lanes
+    std::vector<float> tx_, ty_, tz_;
+    std::vector<float> qx_, qy_, qz_, qw_;
+    std::vector<float> sx_, sy_, sz_;
+
+    // row-major 4x4 matrices
+    std::vector<float> local_;
+    bool local_dirty_ = true;       // local transforms are changed after local matrices are built
+    std::vector<float> world_;
+
+    struct Binding
+    {
+        size_t index;
+        PT(AnimChannelMatrixDynamic) channel;
+
+        // last published local transform
+        bool published;
+        LVecBase3f pos;
+        LQuaternionf quat;
+        LVecBase3f scale;
+    };
+    std::vector<Binding> bindings_;
+    size_t published_count_ = 0;
+    size_t skipped_count_ = 0;
+};
+
+// ************************************************************************************************
+
+inline size_t SkeletonPose::get_joint_count() const
+{
+    return joint_count_;
+}
+
+inline int SkeletonPose::get_parent(size_t index) const
+{
+    return skeleton_->parents[index];
+}
+
+inline const std::string& SkeletonPose::get_name(size_t index) const
+{
+    return skeleton_->names[index];
+}
+
+inline LVecBase3f SkeletonPose::get_local_pos(size_t index) const
+{
+    return LVecBase3f(tx_[index], ty_[index], tz_[index]);
+}
+
+inline LQuaternionf SkeletonPose::get_local_quat(size_t index) const
+{
+    return LQuaternionf(qw_[index], qx_[index], qy_[index], qz_[index]);
+}
+
+inline void SkeletonPose::set_local_pos(size_t index, const LVecBase3f& pos)
+{
+    tx_[index] = pos[0];
+    ty_[index] = pos[1];
+    tz_[index] = pos[2];
+    local_dirty_ = true;
+}
+
+inline void SkeletonPose::set_local_quat(size_t index, const LQuaternionf& quat)
+{
+    qw_[index] = quat.get_r();
+    qx_[index] = quat.get_i();
+    qy_[index] = quat.get_j();
+    qz_[index] = quat.get_k();
+    local_dirty_ = true;
+}
+
+inline void SkeletonPose::set_local_scale(size_t index, const LVecBase3f& scale)
+{
+    sx_[index] = scale[0];
+    sy_[index] = scale[1];
+    sz_[index] = scale[2];
+    local_dirty_ = true;
+}
+
+inline size_t SkeletonPose::get_published_count() const
+{
+    return published_count_;
+}
+
+inline size_t SkeletonPose::get_skipped_count() const
+{
+    return skipped_count_;
+}
+
+inline LMatrix4f SkeletonPose::get_world(size_t index) const
+{
+    const float* m = &world_[index * 16];
+    return LMatrix4f(
+        m[0], m[1], m[2], m[3],
+        m[4], m[5], m[6], m[7],
+        m[8], m[9], m[10], m[11],
+        m[12], m[13], m[14], m[15]);
+}
+
+inline LPoint3f SkeletonPose::get_world_pos(size_t index) const
+{
+    const float* m = &world_[index * 16 + 12];
+    return LPoint3f(m[0], m[1], m[2]);
+}
@@ -0,0 +1,146 @@
+#include "fixed_step_physics.hpp"
+
+#include <algorithm>
+
+namespace {
+
+LQuaternionf nlerp(const LQuaternionf& a, const LQuaternionf& b, float t)
+{
+    // take the shorter arc
+    const LQuaternionf c = a.dot(b) < 0 ? -b : b;
+    LQuaternionf q = a * (1.0f - t) + c * t;
+    q.normalize();
+    return q;
+}
+
+}
+
+FixedStepPhysics::FixedStepPhysics(double dt): dt_(dt)
+{
+    // the clock of the tasks advances by dt in each step regardless of the real time.
+    clock_ = new ClockObject(ClockObject::M_non_real_time);
+    clock_->set_dt(dt_);
+
+    manager_ = new AsyncTaskManager("Physics");
+    manager_->set_clock(clock_);
+}
+
+FixedStepPhysics::~FixedStepPhysics()
+{
+    stop();
+    manager_->cleanup();
+}
+
+void FixedStepPhysics::start(const std::function<void()>& start_physics)
+{
+    AsyncTaskManager* global_manager = AsyncTaskManager::get_global_ptr();
+
+    const AsyncTaskCollection old_tasks = global_manager->get_tasks();
+    start_physics();
+    const AsyncTaskCollection new_tasks = global_manager->get_tasks();
+
+    for (size_t k = 0, k_end = new_tasks.get_num_tasks(); k < k_end; ++k)
+    {
+        AsyncTask* task = new_tasks.get_task(k);
+        if (old_tasks.has_task(task))
+            continue;
+
+        // the default chain of this manager has no thread, so the tasks run in poll() of each step.
+        task->remove();
+        task->set_task_chain("default");
+        manager_->add(task);
+        physics_tasks_.push_back(task);
+    }
+}
+
+void FixedStepPhysics::stop()
+{
+    if (physics_tasks_.empty())
+        return;
+
+    restore();
+
+    AsyncTaskManager* global_manager = AsyncTaskManager::get_global_ptr();
+    for (auto&& task: physics_tasks_)
+    {
+        task->remove();
+        global_manager->add(task);
+    }
+    physics_tasks_.clear();
+}
+
+size_t FixedStepPhysics::add_bodies(NodePath root)
+{
+    const size_t old_count = bodies_.size();
+
+    const NodePathCollection bodies = root.find_all_matches("**/+BulletRigidBodyNode");
+    for (int k = 0, k_end = bodies.get_num_paths(); k < k_end; ++k)
+    {
+        const NodePath body_np = bodies.get_path(k);
+        if (std::find(bodies_.begin(), bodies_.end(), body_np) != bodies_.end())
+            continue;
+
+        bodies_.push_back(body_np);
+        for (auto* state: { &previous_, &current_ })
+        {
+            state->positions.push_back(body_np.get_pos());
+            state->rotations.push_back(body_np.get_quat());
+        }
+    }
+
+    return bodies_.size() - old_count;
+}
+
+void FixedStepPhysics::step()
+{
+    if (physics_tasks_.empty())
+        return;
+
+    const auto begin_time = std::chrono::steady_clock::now();
+
+    restore();
+
+    clock_->tick();
+    manager_->poll();
+
+    std::swap(previous_, current_);
+    for (size_t k = 0, k_end = bodies_.size(); k < k_end; ++k)
+    {
+        current_.positions[k] = bodies_[k].get_pos();
+        current_.rotations[k] = bodies_[k].get_quat();
+    }
+
+    step_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+    ++step_count_;
+}
+
+void FixedStepPhysics::interpolate(double alpha)
+{
+    const float t = static_cast<float>((std::min)((std::max)(alpha, 0.0), 1.0));
+    for (size_t k = 0, k_end = bodies_.size(); k < k_end; ++k)
+    {
+        // static bodies are not written, so their transforms stay clean.
+        const LPoint3f& pos0 = previous_.positions[k];
+        const LPoint3f& pos1 = current_.positions[k];
+        const LQuaternionf& quat0 = previous_.rotations[k];
+        const LQuaternionf& quat1 = current_.rotations[k];
+        if (pos0 == pos1 && quat0 == quat1)
+            continue;
+
+        bodies_[k].set_pos_quat(pos0 * (1.0f - t) + pos1 * t, nlerp(quat0, quat1, t));
+        interpolated_ = true;
+    }
+}
+
+void FixedStepPhysics::restore()
+{
+    if (!interpolated_)
+        return;
+
+    for (size_t k = 0, k_end = bodies_.size(); k < k_end; ++k)
+    {
+        if (previous_.positions[k] != current_.positions[k] || previous_.rotations[k] != current_.rotations[k])
+            bodies_[k].set_pos_quat(current_.positions[k], current_.rotations[k]);
+    }
+    interpolated_ = false;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <asyncTaskManager.h>
+#include <clockObject.h>
+#include <nodePath.h>
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+/**
+ * Physics stepped with a fixed dt by the simulation loop.
+ *
+ * Tasks which the physics engine adds to the task manager are moved to a task manager of its own,
+ * and each step polls them once with a clock which advances by the fixed dt. After each step,
+ * transforms of rigid bodies are kept in a double buffer, and the bodies are rendered at transforms
+ * interpolated between the last two steps.
+ */
+class FixedStepPhysics
+{
+public:
+    FixedStepPhysics(double dt);
+    ~FixedStepPhysics();
+
+    /** Call @a start_physics and move the tasks which it adds to this. */
+    void start(const std::function<void()>& start_physics);
+
+    /** Move the tasks back to the global task manager. */
+    void stop();
+
+    /** Find rigid bodies under @a root to interpolate them. @return the number of added bodies. */
+    size_t add_bodies(NodePath root);
+
+    /** Step the physics from the last stepped transforms of bodies, and keep their new transforms. */
+    void step();
+
+    /**
+     * Write transforms of bodies between the last two steps.
+     * @param alpha  Fraction of a step after the last step, such as SimulationLoop::get_alpha().
+     */
+    void interpolate(double alpha);
+
+    bool is_running() const;
+    double get_dt() const;
+    double get_step_ms() const;
+    uint64_t get_step_count() const;
+    size_t get_body_count() const;
+
+private:
+    struct State
+    {
+        std::vector<LPoint3f> positions;
+        std::vector<LQuaternionf> rotations;
+    };
+
+    /** Restore the last stepped transforms if bodies are interpolated. */
+    void restore();
+
+    const double dt_;
+    PT(ClockObject) clock_;
+    PT(AsyncTaskManager) manager_;
+    std::vector<PT(AsyncTask)> physics_tasks_;
+
+    std::vector<NodePath> bodies_;
+    State previous_;
+    State current_;
+    bool interpolated_ = false;
+
+    double step_ms_ = 0;
+    uint64_t step_count_ = 0;
+};
+
+// ************************************************************************************************
+
+inline bool FixedStepPhysics::is_running() const
+{
+    return !physics_tasks_.empty();
+}
+
+inline double FixedStepPhysics::get_dt() const
+{
+    return dt_;
+}
+
+inline double FixedStepPhysics::get_step_ms() const
+{
+    return step_ms_;
+}
+
+inline uint64_t FixedStepPhysics::get_step_count() const
+{
+    return step_count_;
+}
+
+inline size_t FixedStepPhysics::get_body_count() const
+{
+    return bodies_.size();
+}
@@ -0,0 +1,161 @@
+#include "frame_graph.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include <asyncTaskManager.h>
+#include <genericAsyncTask.h>
+
+FrameGraph::FrameGraph(int thread_count): thread_count_(thread_count)
+{
+    if (thread_count_ <= 0)
+        thread_count_ = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    if (thread_count_ > 1)
+    {
+        chain_ = AsyncTaskManager::get_global_ptr()->make_task_chain("FrameGraph");
+        chain_->set_num_threads(thread_count_ - 1);
+        chain_->set_thread_priority(TP_high);
+
+        for (int k = 1; k < thread_count_; ++k)
+        {
+            PT(AsyncTask) task = new GenericAsyncTask("FrameGraph::run_worker_stages", [](GenericAsyncTask*, void* user_data) {
+                static_cast<FrameGraph*>(user_data)->run_worker_stages();
+                return AsyncTask::DS_done;
+            }, this);
+            task->set_task_chain(chain_->get_name());
+            tasks_.push_back(task);
+        }
+    }
+}
+
+FrameGraph::~FrameGraph()
+{
+    tasks_.clear();
+    if (chain_)
+        AsyncTaskManager::get_global_ptr()->remove_task_chain(chain_->get_name());
+}
+
+size_t FrameGraph::add_stage(const std::string& name, const StageFunction& function,
+    const std::vector<size_t>& dependencies, bool main_thread)
+{
+    const size_t index = stages_.size();
+
+    Stage stage;
+    stage.name = name;
+    stage.function = function;
+    stage.main_thread = main_thread;
+    for (const size_t dependency: dependencies)
+    {
+        // only stages added before, so that the graph has no cycle.
+        if (dependency >= index)
+            continue;
+        stage.dependencies.push_back(dependency);
+        stages_[dependency].dependents.push_back(index);
+    }
+
+    stages_.push_back(std::move(stage));
+    if (!main_thread)
+        ++worker_stage_count_;
+
+    return index;
+}
+
+void FrameGraph::run()
+{
+    begin_time_ = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_count_ = 0;
+        ready_main_stages_.clear();
+        ready_worker_stages_.clear();
+        pending_dependencies_.resize(stages_.size());
+        for (size_t k = 0, k_end = stages_.size(); k < k_end; ++k)
+        {
+            pending_dependencies_[k] = stages_[k].dependencies.size();
+            if (pending_dependencies_[k] == 0)
+                (stages_[k].main_thread ? ready_main_stages_ : ready_worker_stages_).push_back(k);
+        }
+    }
+
+    AsyncTaskManager* manager = AsyncTaskManager::get_global_ptr();
+    const size_t task_count = (std::min)(tasks_.size(), worker_stage_count_);
+    for (size_t k = 0; k < task_count; ++k)
+        manager->add(tasks_[k]);
+
+    // the caller runs stages of the main thread in order, and it runs worker stages while it waits for them.
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (done_count_ < stages_.size())
+    {
+        size_t index;
+        if (!ready_main_stages_.empty())
+        {
+            const auto iter = std::min_element(ready_main_stages_.begin(), ready_main_stages_.end());
+            index = *iter;
+            ready_main_stages_.erase(iter);
+        }
+        else if (!ready_worker_stages_.empty())
+        {
+            index = ready_worker_stages_.back();
+            ready_worker_stages_.pop_back();
+        }
+        else
+        {
+            ready_condition_.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        run_stage(index);
+        lock.lock();
+    }
+    lock.unlock();
+
+    for (size_t k = 0; k < task_count; ++k)
+        tasks_[k]->wait();
+
+    frame_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time_).count();
+}
+
+void FrameGraph::run_stage(size_t index)
+{
+    auto& stage = stages_[index];
+
+    const auto begin_time = std::chrono::steady_clock::now();
+    if (stage.function)
+        stage.function();
+    const auto end_time = std::chrono::steady_clock::now();
+
+    stage.begin_ms = std::chrono::duration<double, std::milli>(begin_time - begin_time_).count();
+    stage.ms = std::chrono::duration<double, std::milli>(end_time - begin_time).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++done_count_;
+    for (const size_t dependent: stage.dependents)
+    {
+        if (--pending_dependencies_[dependent] == 0)
+            (stages_[dependent].main_thread ? ready_main_stages_ : ready_worker_stages_).push_back(dependent);
+    }
+    ready_condition_.notify_all();
+}
+
+void FrameGraph::run_worker_stages()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (done_count_ < stages_.size())
+    {
+        if (ready_worker_stages_.empty())
+        {
+            ready_condition_.wait(lock);
+            continue;
+        }
+
+        const size_t index = ready_worker_stages_.back();
+        ready_worker_stages_.pop_back();
+
+        lock.unlock();
+        run_stage(index);
+        lock.lock();
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <asyncTask.h>
+
+class AsyncTaskChain;
+
+/**
+ * Stages of a frame which run in the order of their dependencies.
+ *
+ * Stages on the main thread run on the caller in the order of addition when their dependencies are done.
+ * The other stages run on the worker threads or the caller as soon as their dependencies are done,
+ * so that they overlap with independent stages.
+ */
+class FrameGraph
+{
+public:
+    using StageFunction = std::function<void()>;
+
+    struct Stage
+    {
+        std::string name;
+        StageFunction function;
+        std::vector<size_t> dependencies;
+        std::vector<size_t> dependents;
+        bool main_thread;
+
+        double begin_ms = 0;            // from the begin of the frame
+        double ms = 0;
+    };
+
+    /** @param thread_count   The number of threads including the caller. If it is 0, the number of cores is used. */
+    FrameGraph(int thread_count = 0);
+    ~FrameGraph();
+
+    /**
+     * Add the stage which runs after @a dependencies. Dependencies are stages added before.
+     * @param main_thread   The stage uses the state of the main thread, such as events, loaders and the IK.
+     * @return  The index of the stage.
+     */
+    size_t add_stage(const std::string& name, const StageFunction& function,
+        const std::vector<size_t>& dependencies = {}, bool main_thread = true);
+
+    /** Run all stages and wait for them. */
+    void run();
+
+    int get_thread_count() const;
+    double get_frame_ms() const;
+    const std::vector<Stage>& get_stages() const;
+
+private:
+    void run_stage(size_t index);
+
+    /** Run ready stages of the workers until all stages are done. */
+    void run_worker_stages();
+
+    int thread_count_;
+    AsyncTaskChain* chain_ = nullptr;
+    std::vector<PT(AsyncTask)> tasks_;         // a task per worker which is added in each frame
+
+    std::vector<Stage> stages_;
+    size_t worker_stage_count_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable ready_condition_;
+    std::vector<size_t> pending_dependencies_;
+    std::vector<size_t> ready_main_stages_;
+    std::vector<size_t> ready_worker_stages_;
+    size_t done_count_ = 0;
+
+    std::chrono::steady_clock::time_point begin_time_;
+    double frame_ms_ = 0;
+};
+
+// ************************************************************************************************
+
+inline int FrameGraph::get_thread_count() const
+{
+    return thread_count_;
+}
+
+inline double FrameGraph::get_frame_ms() const
+{
+    return frame_ms_;
+}
+
+inline const std::vector<FrameGraph::Stage>& FrameGraph::get_stages() const
+{
+    return stages_;
+}
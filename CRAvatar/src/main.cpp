@@ -1,7 +1,22 @@
 #include "main.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+
 #include <spdlog/spdlog.h>
 
+#include <configVariableBool.h>
+#include <configVariableDouble.h>
+#include <configVariableInt.h>
+#include <configVariableFilename.h>
+#include <character.h>
+#include <modelNode.h>
+#include <clockObject.h>
+
 #include <render_pipeline/rppanda/showbase/showbase.hpp>
 #include <render_pipeline/rpcore/render_pipeline.hpp>
 #include <render_pipeline/rpcore/loader.hpp>
@@ -20,10 +35,26 @@
 #include <crsf/CREngine/TDynamicModuleManager.h>
 #include <crsf/CREngine/TPhysicsManager.h>
 
+#include "avatar/animated_bounds.hpp"
+#include "avatar/animation_clip.hpp"
+#include "avatar/animation_layer.hpp"
+#include "avatar/asset_cache.hpp"
+#include "avatar/avatar_library.hpp"
+#include "avatar/avatar_memory_layout.hpp"
+#include "avatar/control_joints.hpp"
+#include "avatar/cpu_skinning.hpp"
+#include "avatar/crowd.hpp"
+#include "avatar/skeleton_index.hpp"
+#include "avatar/skeleton_pose.hpp"
+#include "frame_graph.hpp"
 #include "main_gui/main_gui.hpp"
 #include "objects/floor.hpp"
+#include "objects/static_batch.hpp"
 #include "openvr_manager.hpp"
+#include "fixed_step_physics.hpp"
+#include "simulation_loop.hpp"
 #include "ar_system.hpp"
+#include "startup_profiler.hpp"
 
 #include "simple_ik/module.h"
 
@@ -32,10 +63,82 @@ CRSEEDLIB_MODULE_CREATOR(MainApp);
 // ************************************************************************************************
 spdlog::logger* global_logger = nullptr;
 
+ConfigVariableBool cravatar_ik_benchmark("cravatar-ik-benchmark", false,
+    "Show all avatars with foot placement, move the arm target and log statistics of the IK.");
+
+ConfigVariableInt cravatar_ik_threads("cravatar-ik-threads", 0,
+    "The number of threads to solve arms of actors. If it is 0, the number of cores is used.");
+
+ConfigVariableBool cravatar_ik_avatar_memory("cravatar-ik-avatar-memory", false,
+    "Solve the arm of the current avatar in its avatar memory object instead of its joints. The memory starts from the bind pose of the joints.");
+
+ConfigVariableInt cravatar_avatar_loader_threads("cravatar-avatar-loader-threads", 0,
+    "The number of threads to decode avatar models. If it is 0, the number of cores is used.");
+
+ConfigVariableInt cravatar_avatar_memory_cap("cravatar-avatar-memory-cap", 512,
+    "Memory (MiB) of instantiated avatars. Least recently used avatars are evicted over this cap.");
+
+ConfigVariableBool cravatar_selective_control_joints("cravatar-selective-control-joints", true,
+    "Create control joints only for joints driven by the IK. Otherwise, all joints become control joints.");
+
+ConfigVariableInt cravatar_crowd_size("cravatar-crowd-size", 0,
+    "The number of crowd instances which share models of avatars. Instances are spread over all avatars.");
+
+ConfigVariableBool cravatar_animated_bounds("cravatar-animated-bounds", true,
+    "Cull avatars with bounds which follow their joints. Otherwise, culling of avatars is disabled.");
+
+ConfigVariableBool cravatar_cpu_skinning("cravatar-cpu-skinning", false,
+    "Skin avatar meshes on CPU worker threads instead of the vertex animation of Panda3D. It is for runs without GPU.");
+
+ConfigVariableInt cravatar_cpu_skinning_threads("cravatar-cpu-skinning-threads", 0,
+    "The number of threads of the CPU skinning. If it is 0, the number of cores is used.");
+
+ConfigVariableBool cravatar_async_scene_loading("cravatar-async-scene-loading", true,
+    "Load furniture and tracker models on worker threads and attach them when they are ready. Otherwise, they are loaded before the first frame.");
+
+ConfigVariableBool cravatar_scene_placeholders("cravatar-scene-placeholders", true,
+    "Show boxes at the places of furniture until their models are attached.");
+
+ConfigVariableBool cravatar_static_batching("cravatar-static-batching", true,
+    "Flatten furniture and merge it by render state after it is placed. Otherwise, each piece is a world object with its original hierarchy.");
+
+ConfigVariableBool cravatar_physics_fixed_step("cravatar-physics-fixed-step", true,
+    "Step the physics after the IK in each simulation step with its fixed dt, and render bodies interpolated between steps. "
+    "Otherwise, the physics steps in its own tasks on the main loop.");
+
+ConfigVariableInt cravatar_simulation_rate("cravatar-simulation-rate", 90,
+    "Steps per second of tracker sampling, filtering, IK and physics. If it is 0, the IK is solved in its own task every frame.");
+
+ConfigVariableDouble cravatar_tracker_smoothing("cravatar-tracker-smoothing", 0.01,
+    "Time constant (s) of the low-pass filter of tracker samples. If it is 0, samples are not filtered.");
+
+ConfigVariableFilename cravatar_simulation_record("cravatar-simulation-record", "",
+    "File to record tracker samples of simulation steps on exit.");
+
+ConfigVariableFilename cravatar_simulation_replay("cravatar-simulation-replay", "",
+    "Recorded tracker samples to replay one step per frame after avatars are loaded. The result and the time of stages are logged at the end.");
+
+ConfigVariableBool cravatar_frame_graph("cravatar-frame-graph", true,
+    "Run stages of a frame in the order of their dependencies in one task, and independent stages in parallel. Otherwise, the IK and the controller events run in their own tasks.");
+
+ConfigVariableInt cravatar_frame_graph_threads("cravatar-frame-graph-threads", 0,
+    "The number of threads of the frame graph including the main thread. If it is 0, the number of cores is used.");
+
+ConfigVariableFilename cravatar_startup_trace("cravatar-startup-trace", "startup_trace.json",
+    "Chrome trace file of startup phases until the first frame and the initial loads. If it is empty, only the summary is logged.");
+
+ConfigVariableFilename cravatar_asset_cache_dir("cravatar-asset-cache-dir", "cache/avatars",
+    "Directory of cooked avatar models and skeleton indices. If it is empty, the cache is not used.");
+
+constexpr int MainApp::ik_benchmark_frame_count;
+
 MainApp::MainApp(): crsf::TDynamicModuleInterface(CRMODULE_ID_STRING)
 {
     global_logger = m_logger.get();
 
+    startup_profiler_ = std::make_unique<StartupProfiler>();
+
+    StartupProfiler::Scope scope(startup_profiler_.get(), "MainApp::setup_physics");
     setup_physics();
 }
 
@@ -43,18 +146,26 @@ MainApp::~MainApp() = default;
 
 void MainApp::OnLoad()
 {
+    StartupProfiler::Scope scope(startup_profiler_.get(), "MainApp::OnLoad");
+
     rendering_engine_ = crsf::TGraphicRenderEngine::GetInstance();
     pipeline_ = rendering_engine_->GetRenderPipeline();
     auto plugin_mgr = pipeline_->get_plugin_mgr();
 
     rendering_engine_->SetWindowTitle(CRMODULE_ID_STRING);
 
-    openvr_manager_ = std::make_unique<OpenVRManager>(*pipeline_);
-    if (!openvr_manager_->is_available())
-        openvr_manager_.reset();
+    {
+        StartupProfiler::Scope openvr_scope(startup_profiler_.get(), "OpenVRManager");
+        openvr_manager_ = std::make_unique<OpenVRManager>(*pipeline_, !cravatar_frame_graph);
+        if (!openvr_manager_->is_available())
+            openvr_manager_.reset();
+    }
 
-    if (plugin_mgr->is_plugin_enabled("ar_render"))
-        ar_system_ = std::make_unique<ARSystem>(*pipeline_);
+    {
+        StartupProfiler::Scope ar_scope(startup_profiler_.get(), "ARSystem");
+        if (plugin_mgr->is_plugin_enabled("ar_render"))
+            ar_system_ = std::make_unique<ARSystem>(*pipeline_);
+    }
 
     rendering_engine_->EnableControl();
     if (!openvr_manager_)
@@ -64,35 +175,118 @@ void MainApp::OnLoad()
 
 void MainApp::OnStart()
 {
-    LVecBase3f floor_scale(15.0f, 15.0f, 0.02f);
-    floor_ = std::make_unique<Floor>("floor",
-        LMatrix4f::scale_mat(floor_scale) *
-        LMatrix4f::translate_mat(0, 0, -floor_scale[3] / 2.0f));
-    floor_->setup_graphics();
-    floor_->setup_physics();
-    rendering_engine_->GetWorld()->AddWorldObject(floor_->get_object());
+    StartupProfiler::Scope scope(startup_profiler_.get(), "MainApp::OnStart");
 
-    setup_ik();
-    setup_avatar();
-    setup_chair();
+    // all models of the scene start to load before the others are set up.
+    if (cravatar_async_scene_loading)
+        scene_loader_ = std::make_unique<AvatarLoader>(0, "SceneLoader", TP_normal);
 
-    main_gui_ = std::make_unique<MainGUI>(*this);
+    {
+        StartupProfiler::Scope floor_scope(startup_profiler_.get(), "Floor");
+        LVecBase3f floor_scale(15.0f, 15.0f, 0.02f);
+        floor_ = std::make_unique<Floor>("floor",
+            LMatrix4f::scale_mat(floor_scale) *
+            LMatrix4f::translate_mat(0, 0, -floor_scale[3] / 2.0f));
+        floor_->setup_graphics();
+        floor_->setup_physics();
+        rendering_engine_->GetWorld()->AddWorldObject(floor_->get_object());
+    }
 
-    add_task([this](const rppanda::FunctionalTask* task) {
-        update();
-        return AsyncTask::DoneStatus::DS_cont;
-    }, "MainApp::update");
+    {
+        StartupProfiler::Scope ik_scope(startup_profiler_.get(), "MainApp::setup_ik");
+        setup_ik();
+    }
+    {
+        StartupProfiler::Scope simulation_scope(startup_profiler_.get(), "MainApp::setup_simulation");
+        setup_simulation();
+    }
+    if (cravatar_frame_graph)
+        setup_frame_graph();
+    {
+        StartupProfiler::Scope avatar_scope(startup_profiler_.get(), "MainApp::setup_avatar");
+        setup_avatar();
+    }
+    {
+        StartupProfiler::Scope chair_scope(startup_profiler_.get(), "MainApp::setup_chair");
+        setup_chair();
+    }
+
+    {
+        StartupProfiler::Scope gui_scope(startup_profiler_.get(), "MainGUI");
+        main_gui_ = std::make_unique<MainGUI>(*this);
+    }
+
+    if (frame_graph_)
+    {
+        add_task([this](const rppanda::FunctionalTask* task) {
+            frame_graph_->run();
+            return AsyncTask::DoneStatus::DS_cont;
+        }, "MainApp::frame_graph");
+    }
+    else
+    {
+        add_task([this](const rppanda::FunctionalTask* task) {
+            update();
+            return AsyncTask::DoneStatus::DS_cont;
+        }, "MainApp::update");
+    }
 
     do_method_later(1.0f, [this](rppanda::FunctionalTask* task) {
-        crsf::TPhysicsManager::GetInstance()->Start();
+        if (physics_)
+        {
+            physics_->start([]() { crsf::TPhysicsManager::GetInstance()->Start(); });
+            if (physics_->is_running())
+            {
+                const size_t body_count = physics_->add_bodies(rendering_engine_->GetWorld()->GetNodePath());
+                m_logger->info("Physics steps in the simulation loop with dt {:.4f} s ({} bodies)", physics_->get_dt(), body_count);
+            }
+            else
+            {
+                m_logger->warn("Physics did not add a task, so it steps as before");
+            }
+        }
+        else
+        {
+            crsf::TPhysicsManager::GetInstance()->Start();
+        }
         return AsyncTask::DoneStatus::DS_done;
     }, "MainApp::start_physics");
 }
 
 void MainApp::OnExit()
 {
+    remove_all_tasks();
+    frame_graph_.reset();
+
     main_gui_.reset();
 
+    // models are removed from the physics after its tasks are moved back.
+    physics_.reset();
+
+    if (tracker_recording_ && !tracker_replay_)
+    {
+        const Filename record_file = cravatar_simulation_record.get_value();
+        if (tracker_recording_->write(record_file))
+            m_logger->info("Recorded {} simulation steps: {}", tracker_recording_->size(), record_file.to_os_specific());
+        else
+            m_logger->warn("Failed to record simulation steps: {}", record_file.to_os_specific());
+    }
+    tracker_recording_.reset();
+    simulation_loop_.reset();
+
+    scene_loader_.reset();
+    static_batch_.reset();
+    avatar_loader_.reset();
+    cpu_skinning_.reset();
+    crowd_.reset();
+    if (avatar_library_)
+    {
+        for (size_t k = 0, k_end = avatar_library_->size(); k < k_end; ++k)
+            AvatarMemoryLayout::delete_memory_object((*avatar_library_)[k].memory_object);
+    }
+    avatar_library_.reset();
+    asset_cache_.reset();
+
     // release some resources
     floor_.reset();
 
@@ -115,11 +309,189 @@ void MainApp::setup_ik()
     auto dmm = crsf::TDynamicModuleManager::GetInstance();
     if (dmm->IsModuleEnabled("simple_ik"))
     {
-        trackers_[0] = rpcore::RPLoader::load_model("resources/models/vr_tracker_vive.bam");
-        trackers_[0].reparent_to(cr_world->GetNodePath());
-        trackers_[1] = trackers_[0].copy_to(cr_world->GetNodePath());
+        // trackers are used as targets before their models are loaded.
+        trackers_[0] = cr_world->GetNodePath().attach_new_node("tracker_0");
+        trackers_[1] = cr_world->GetNodePath().attach_new_node("tracker_1");
+        load_scene_model("resources/models/vr_tracker_vive.bam", [this](NodePath model) {
+            model.copy_to(trackers_[1]);
+            model.reparent_to(trackers_[0]);
+        });
 
         simple_ik_ = std::dynamic_pointer_cast<SimpleIKModule>(dmm->GetModuleInstance("simple_ik")).get();
+        simple_ik_->SetThreadCount(cravatar_ik_threads);
+        simple_ik_->SetGroundQuery([this](const std::vector<GroundRay>& rays, std::vector<GroundHit>& hits) {
+            floor_->raycast(rays, hits);
+        });
+    }
+}
+
+void MainApp::setup_simulation()
+{
+    if (cravatar_simulation_rate <= 0)
+        return;
+
+    simulation_loop_ = std::make_unique<SimulationLoop>(cravatar_simulation_rate.get_value());
+
+    if (simple_ik_)
+        setup_simulation_ik();
+
+    if (cravatar_physics_fixed_step)
+    {
+        physics_ = std::make_unique<FixedStepPhysics>(simulation_loop_->get_dt());
+        simulation_loop_->add_stage("physics", [this](uint64_t, double) {
+            physics_->step();
+        });
+    }
+}
+
+void MainApp::setup_simulation_ik()
+{
+    const Filename replay_file = cravatar_simulation_replay.get_value();
+    if (!replay_file.empty())
+    {
+        tracker_recording_ = TrackerRecording::read(replay_file);
+        if (tracker_recording_ && tracker_recording_->size() == 0)
+            tracker_recording_.reset();
+        tracker_replay_ = tracker_recording_ != nullptr;
+        if (!tracker_replay_)
+            m_logger->warn("Failed to read simulation steps: {}", replay_file.to_os_specific());
+        else if (tracker_recording_->get_step_rate() != static_cast<float>(simulation_loop_->get_rate()))
+            m_logger->warn("Simulation steps are recorded at {} Hz, but they are replayed at {} Hz", tracker_recording_->get_step_rate(), simulation_loop_->get_rate());
+    }
+    else if (!cravatar_simulation_record.get_value().empty())
+    {
+        tracker_recording_ = std::make_unique<TrackerRecording>(static_cast<float>(simulation_loop_->get_rate()));
+    }
+
+    NodePath world_np = rendering_engine_->GetWorld()->GetNodePath();
+    ik_target_ = world_np.attach_new_node("ik_target");
+
+    simulation_loop_->add_stage("tracker sampling", [this, world_np](uint64_t, double) {
+        if (tracker_replay_)
+        {
+            tracker_sample_ = (*tracker_recording_)[replay_step_];
+            trackers_[0].set_pos_quat(world_np, tracker_sample_.pos, tracker_sample_.quat);
+        }
+        else
+        {
+            tracker_sample_.pos = trackers_[0].get_pos(world_np);
+            tracker_sample_.quat = trackers_[0].get_quat(world_np);
+            if (tracker_recording_)
+                tracker_recording_->add(tracker_sample_);
+        }
+    });
+
+    simulation_loop_->add_stage("tracker filter", [this](uint64_t, double dt) {
+        const double smoothing = cravatar_tracker_smoothing;
+        if (filtered_tracker_valid_ && smoothing > 0)
+        {
+            // low-pass of the position and the rotation in the shorter arc
+            const float t = static_cast<float>(1.0 - std::exp(-dt / smoothing));
+            filtered_tracker_.pos = filtered_tracker_.pos * (1.0f - t) + tracker_sample_.pos * t;
+            const LQuaternionf quat = filtered_tracker_.quat.dot(tracker_sample_.quat) < 0 ? -tracker_sample_.quat : tracker_sample_.quat;
+            filtered_tracker_.quat = filtered_tracker_.quat * (1.0f - t) + quat * t;
+            filtered_tracker_.quat.normalize();
+        }
+        else
+        {
+            filtered_tracker_ = tracker_sample_;
+            filtered_tracker_valid_ = true;
+        }
+
+        // the IK of the step may run in a later stage of the frame after filters of the other steps.
+        filtered_targets_.push_back(filtered_tracker_);
+    });
+    simulation_input_stage_count_ = simulation_loop_->get_stages().size();
+
+    simulation_loop_->add_stage("IK", [this, world_np](uint64_t, double) {
+        if (!filtered_targets_.empty())
+        {
+            const TrackerRecording::Sample target = filtered_targets_.front();
+            filtered_targets_.pop_front();
+            ik_target_.set_pos_quat(world_np, target.pos, target.quat);
+        }
+
+        simple_ik_->SolveIK();
+        simple_ik_->SolveFootPlacement();
+
+        if (!tracker_replay_)
+            return;
+
+        // FNV-1a over words of solved joints to compare replays
+        for (auto&& joint: replay_joints_)
+        {
+            const LPoint3f pos = joint.get_pos();
+            for (int k = 0; k < 3; ++k)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &pos[k], sizeof(bits));
+                replay_hash_ = (replay_hash_ ^ bits) * 1099511628211ull;
+            }
+        }
+
+        if (++replay_step_ == tracker_recording_->size())
+            finish_replay();
+    });
+}
+
+void MainApp::find_replay_joints()
+{
+    std::vector<std::string> driven_joints;
+    std::vector<std::string> observed_joints;
+    simple_ik_->GetJointNames(driven_joints, observed_joints);
+
+    NodePath actor_np = current_actor_->GetNodePath();
+    for (const auto& name: driven_joints)
+    {
+        NodePath joint = actor_np.find("**/" + name);
+        if (joint)
+            replay_joints_.push_back(joint);
+    }
+}
+
+void MainApp::finish_replay()
+{
+    const size_t step_count = tracker_recording_->size();
+    m_logger->info("Replayed {} simulation steps at {} Hz: joints hash {:016x}", step_count, simulation_loop_->get_rate(), replay_hash_);
+    for (const auto& stage: simulation_loop_->get_stages())
+        m_logger->info("Replay stage {}: {:.3f} ms per step", stage.name, stage.total_ms / step_count);
+
+    // continue with live trackers
+    tracker_replay_ = false;
+    tracker_recording_.reset();
+    simulation_loop_->reset_statistics();
+}
+
+void MainApp::setup_frame_graph()
+{
+    frame_graph_ = std::make_unique<FrameGraph>(cravatar_frame_graph_threads);
+
+    // loading attaches avatars and switches the actor, so the stages of avatars run after it.
+    const size_t loading = frame_graph_->add_stage("scene loading", [this]() { update_loaders(); });
+
+    const size_t tracker_input = frame_graph_->add_stage("tracker input", [this]() {
+        if (openvr_manager_)
+            openvr_manager_->process_controller_event();
+    });
+
+    // the simulation loop samples and filters trackers of its steps, and then solves the IK and steps the physics of them.
+    const size_t tracker_filter = frame_graph_->add_stage("tracker filter", [this]() { update_tracker_filter(); }, { loading, tracker_input });
+    const size_t ik = frame_graph_->add_stage("IK", [this]() { update_ik(); }, { loading, tracker_filter });
+
+    // clips of avatars and crowd instances are blended on the workers while the IK is solved,
+    // and their poses are written to the characters on the main thread.
+    const size_t animation = frame_graph_->add_stage("animation", [this]() { animate_avatars(); }, { loading }, false);
+    const size_t crowd = frame_graph_->add_stage("crowd", [this]() { update_crowd(); }, { loading }, false);
+    const size_t skeleton = frame_graph_->add_stage("skeleton", [this]() { update_avatars(); }, { ik, animation });
+
+    const size_t render_sync = frame_graph_->add_stage("render sync", [this]() { sync_render(); }, { skeleton, crowd });
+
+    if (cravatar_ik_benchmark)
+    {
+        frame_graph_->add_stage("IK benchmark", [this]() {
+            if (simple_ik_)
+                update_ik_benchmark();
+        }, { render_sync });
     }
 }
 
@@ -128,73 +500,920 @@ void MainApp::setup_avatar()
     crsf::TWorld* cr_world = rendering_engine_->GetWorld();
 
     // 1 meter axis on origin
-    NodePath axis_model = rpcore::RPLoader::load_model("/$$crsf/examples/resources/models/zup-axis.bam");
-    axis_model.reparent_to(cr_world->GetNodePath());
-    axis_model.set_scale(0.1f);
+    {
+        StartupProfiler::Scope scope(startup_profiler_.get(), "load zup-axis.bam");
+        NodePath axis_model = rpcore::RPLoader::load_model("/$$crsf/examples/resources/models/zup-axis.bam");
+        axis_model.reparent_to(cr_world->GetNodePath());
+        axis_model.set_scale(0.1f);
+    }
+
+    avatar_library_ = std::make_unique<AvatarLibrary>();
+    {
+        StartupProfiler::Scope scope(startup_profiler_.get(), "AvatarLibrary::scan");
+        if (avatar_library_->scan(Filename("resources/models/avatars")) == 0)
+            return;
+    }
+
+    avatar_loader_ = std::make_unique<AvatarLoader>(cravatar_avatar_loader_threads);
+
+    if (!cravatar_asset_cache_dir.get_value().empty())
+        asset_cache_ = std::make_unique<AssetCache>(cravatar_asset_cache_dir);
+
+    if (cravatar_crowd_size > 0)
+        crowd_ = std::make_unique<Crowd>(rendering_engine_->GetWorld()->GetNodePath());
+
+    if (cravatar_cpu_skinning)
+        cpu_skinning_ = std::make_unique<CpuSkinning>(cravatar_cpu_skinning_threads);
+
+    // benchmark and crowd scenes use all avatars
+    if (cravatar_ik_benchmark || crowd_)
+    {
+        for (size_t k = 0, k_end = avatar_library_->size(); k < k_end; ++k)
+            load_avatar(k);
+    }
 
-    const Filename model_base_dir("resources/models/avatars");
+    select_avatar(0);
+}
 
-    vector_string paths;
-    if (!model_base_dir.scan_directory(paths))
+void MainApp::load_avatar(size_t index)
+{
+    auto& entry = (*avatar_library_)[index];
+    if (entry.actor || entry.loading)
         return;
 
-    for (const auto& path: paths)
+    if (!avatar_loader_->is_busy())
+        avatar_load_begin_time_ = std::chrono::steady_clock::now();
+
+    if (asset_cache_ && !entry.skeleton)
     {
-        Filename model_file = model_base_dir / path / (path + ".bam");
-        if (!model_file.exists())
+        if (asset_cache_->find(entry.source_file, entry.model_file, entry.skeleton))
+            m_logger->debug("Use cooked avatar: {}", entry.model_file.get_fullpath());
+    }
+
+    entry.loading = true;
+    avatar_loader_->request(entry.model_file, [this, index](const AvatarLoader::Result& result) { add_avatar(index, result); });
+}
+
+void MainApp::add_avatar(size_t index, const AvatarLoader::Result& result)
+{
+    auto& entry = (*avatar_library_)[index];
+    entry.loading = false;
+
+    if (result.model.is_empty())
+    {
+        m_logger->error("Failed to load avatar: {}", result.model_file.get_fullpath());
+        return;
+    }
+
+    const auto begin_time = std::chrono::steady_clock::now();
+
+    // loads which finish in the startup are profiled.
+    StartupProfiler::Scope scope(startup_profiler_.get(), "MainApp::add_avatar " + entry.name);
+    if (startup_profiler_)
+        startup_profiler_->add_event("load " + entry.name, "avatar " + entry.name, result.wait_ms);
+
+    // cook before the actor takes the model
+    if (asset_cache_ && !entry.skeleton)
+    {
+        if (asset_cache_->cook(entry.source_file, result.model, entry.skeleton))
         {
-            model_file = model_base_dir / path / (path + ".egg");
-            if (!model_file.exists())
-                continue;
+            m_logger->info("Cooked avatar {} ({} joints) in {:.1f} ms", entry.name, entry.skeleton->get_joint_count(),
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count());
+        }
+        else
+        {
+            m_logger->warn("Failed to cook avatar: {}", entry.source_file.get_fullpath());
         }
+    }
 
-        auto actor = crsf::CreateObject<crsf::TActorObject>();
-        actor->CreateActor(rppanda::Actor::ModelsType(model_file));       // unit is cm
-        actor->SetScale(0.01f);
-        cr_world->AddWorldObject(actor);
-        actors_.push_back(actor);
-        actor->DisableTestBounding();
+    const auto attach_begin_time = std::chrono::steady_clock::now();
+
+    crsf::TWorld* cr_world = rendering_engine_->GetWorld();
+
+    auto actor = crsf::CreateObject<crsf::TActorObject>();
+    actor->CreateActor(rppanda::Actor::ModelsType(result.model));       // unit is cm
+    actor->SetScale(0.01f);
+    cr_world->AddWorldObject(actor);
+    if (cravatar_selective_control_joints && simple_ik_)
+    {
+        std::vector<std::string> driven_joints;
+        std::vector<std::string> observed_joints;
+        simple_ik_->GetJointNames(driven_joints, observed_joints);
+
+        const std::unordered_set<std::string> driven_joint_set(driven_joints.begin(), driven_joints.end());
+        const size_t node_count = make_control_joints(actor->GetNodePath(),
+            driven_joint_set,
+            { observed_joints.begin(), observed_joints.end() });
+        m_logger->debug("Created {} joint nodes of avatar {}", node_count, entry.name);
+
+        // the other joints are animated by clips
+        if (entry.skeleton)
+        {
+            entry.animation = std::make_shared<AnimationLayer>(*entry.skeleton);
+            setup_animation_clips(entry);
+            entry.animation->bind(actor->GetNodePath(), driven_joint_set);
+        }
+    }
+    else
+    {
         actor->GetMainCharacter()->MakeAllControlJoint();    // create joints
-        actor->Hide();
+    }
 
-        crsf::TCRProperty avatar_props;
-        avatar_props.m_strName = actor->GetName();
-        avatar_props.m_propAvatar.SetJointNumber(71);
-        crsf::TDynamicStageMemory::GetInstance()->CreateAvatarMemoryObject(avatar_props);
+    if (cravatar_animated_bounds)
+    {
+        entry.bounds = std::make_shared<AnimatedBounds>(actor->GetNodePath());
+        if (entry.animation)
+            entry.bounds->bind(entry.animation->get_pose());
+    }
+    else
+    {
+        actor->DisableTestBounding();
+    }
+    actor->Hide();
+
+    entry.actor = actor;
+    entry.memory_bytes = AvatarLibrary::estimate_memory(actor->GetNodePath(), entry.textures);
+
+    // the memory object lives while the app runs, so it is created at the first load.
+    if (!entry.memory_layout)
+    {
+        entry.memory_layout = entry.skeleton ?
+            std::make_shared<AvatarMemoryLayout>(*entry.skeleton) :
+            std::make_shared<AvatarMemoryLayout>(actor->GetNodePath());
+        entry.memory_object = entry.memory_layout->create_memory_object(actor->GetName());
+        if (simple_ik_ && entry.memory_object)
+            write_memory_bind_pose(entry);
+    }
+
+    m_logger->info("Loaded avatar {}: decoding {:.1f} ms, waiting {:.1f} ms, attaching {:.1f} ms, memory {:.2f} MiB",
+        entry.name, result.decode_ms, result.wait_ms,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - attach_begin_time).count(),
+        avatar_library_->get_memory(index) / (1024.0 * 1024.0));
+
+    if (crowd_)
+    {
+        // instances are spread over avatars in turn
+        const size_t avatar_count = avatar_library_->size();
+        const size_t instance_count = (cravatar_crowd_size + avatar_count - 1 - index) / avatar_count;
+        const size_t instance_bytes = crowd_->get_instance_memory();
+
+        crowd_->add_instances(entry.name, result.model, entry.skeleton, instance_count);
+
+        m_logger->info("Crowd: {} instances of {} use {:.2f} MiB (full copies would use {:.2f} MiB), {} instances in total",
+            instance_count, entry.name, (crowd_->get_instance_memory() - instance_bytes) / (1024.0 * 1024.0),
+            instance_count * avatar_library_->get_memory(index) / (1024.0 * 1024.0), crowd_->size());
+    }
+
+    // after crowd instances copy the model which is animated by Panda3D
+    if (cpu_skinning_)
+    {
+        const size_t vertex_count = cpu_skinning_->add_meshes(actor->GetNodePath(), true);
+        m_logger->debug("CPU skinning of avatar {}: {} vertices", entry.name, vertex_count);
+    }
+
+    if (simple_ik_)
+    {
+        // bindings are prepared at load, so switching actors does not search the scene graph.
+        if (!simple_ik_->PrepareActor(actor.get()))
+            m_logger->warn("Arm joints of avatar {} are not found", entry.name);
+        simple_ik_->AddFootPlacement(actor.get());
+    }
+
+    if (cravatar_ik_benchmark)
+    {
+        // line up all avatars on the floor
+        actor->SetPosition(static_cast<float>(index % 10) - 4.5f, static_cast<float>(index / 10) + 1.0f, 0);
+        actor->Show();
+
+        // arms of all avatars are solved with the current actor.
+        if (simple_ik_)
+        {
+            entry.ik_target = actor->GetNodePath().attach_new_node("ik_target");
+            if (!simple_ik_->BindActor(actor.get(), entry.ik_target))
+                entry.ik_target.remove_node();
+        }
     }
 
-    change_actor(actors_.front().get());
+    if (pending_avatar_ == index)
+        select_avatar(index);
+    else
+        evict_avatars();
+}
+
+void MainApp::write_memory_bind_pose(AvatarLibrary::Entry& entry)
+{
+    std::vector<std::string> driven_joints;
+    std::vector<std::string> observed_joints;
+    simple_ik_->GetJointNames(driven_joints, observed_joints);
+
+    // the solver computes bone lengths from the poses of the memory.
+    NodePath actor_np = entry.actor->GetNodePath();
+    for (const auto& name: driven_joints)
+    {
+        const int slot = entry.memory_layout->find_slot(name);
+        NodePath joint = actor_np.find("**/" + name);
+        if (slot < 0 || !joint)
+            continue;
+
+        auto pose = entry.memory_object->GetAvatarMemory(slot);
+        pose.SetPosition(joint.get_pos());
+        pose.SetQuaternion(joint.get_quat());
+        entry.memory_object->SetAvatarMemory(slot, pose);
+    }
+}
+
+void MainApp::select_avatar(size_t index)
+{
+    if (index >= avatar_library_->size())
+        return;
+
+    avatar_library_->touch(index);
+
+    auto& entry = (*avatar_library_)[index];
+    if (!entry.actor)
+    {
+        // instantiate on the first selection
+        pending_avatar_ = index;
+        load_avatar(index);
+        return;
+    }
+
+    pending_avatar_ = std::numeric_limits<size_t>::max();
+    current_avatar_ = index;
+    change_actor(entry.actor.get());
+
+    evict_avatars();
+}
+
+void MainApp::evict_avatars()
+{
+    if (cravatar_ik_benchmark)
+        return;
+
+    const size_t memory_cap = static_cast<size_t>(cravatar_avatar_memory_cap) * 1024 * 1024;
+    for (const size_t index: avatar_library_->select_evictions(memory_cap, current_avatar_))
+    {
+        auto& entry = (*avatar_library_)[index];
+
+        if (simple_ik_)
+            simple_ik_->RemoveActor(entry.actor.get());
+        entry.animation.reset();
+        entry.bounds.reset();
+        entry.ik_target.clear();
+        if (cpu_skinning_)
+            cpu_skinning_->remove_meshes(entry.actor->GetNodePath());
+
+        m_logger->debug("Evicted avatar {} ({:.2f} MiB)", entry.name, avatar_library_->get_memory(index) / (1024.0 * 1024.0));
+
+        // models are loaded without the model pool, so the geometry is freed with the actor.
+        avatar_library_->release_textures(index);
+        entry.actor->DetachWorldObject();
+        entry.actor.reset();
+    }
 }
 
 void MainApp::setup_chair()
 {
     crsf::TWorld* cr_world = rendering_engine_->GetWorld();
 
-    auto ikea_ekero = crsf::CreateObject(rpcore::RPLoader::load_model("resources/models/ikea-ekero/ikea-ekero.bam"));
-    cr_world->AddWorldObject(ikea_ekero);
-    ikea_ekero->SetScale(0.4f);
-    ikea_ekero->SetPosition(3, 0, 0);
-    ikea_ekero->SetHPR(-25, 0, 0);
+    struct Furniture
+    {
+        const char* model_file;
+        float scale;
+        LVecBase3f pos;
+        LVecBase3f hpr;
+        LVecBase3f placeholder_size;    // meter
+    };
+
+    static const Furniture furnitures[] = {
+        { "resources/models/ikea-ekero/ikea-ekero.bam", 0.4f, LVecBase3f(3, 0, 0), LVecBase3f(-25, 0, 0), LVecBase3f(0.7f, 0.8f, 0.8f) },
+        { "resources/models/ikea-tullsta/ikea-tullsta.bam", 0.075f, LVecBase3f(-3, 1, 0), LVecBase3f(35, 0, 0), LVecBase3f(0.8f, 0.7f, 0.8f) },
+        { "resources/models/ikea-henriksdal/henriksdal.bam", 0.01f, LVecBase3f(-2, -2, 0), LVecBase3f(45, 0, 0), LVecBase3f(0.5f, 0.5f, 1.0f) },
+    };
+
+    if (cravatar_static_batching)
+        static_batch_ = std::make_unique<StaticBatch>(cr_world->GetNodePath());
+
+    for (const auto& furniture: furnitures)
+    {
+        std::shared_ptr<crsf::TCube> placeholder;
+        if (scene_loader_ && cravatar_scene_placeholders)
+        {
+            const LVecBase3f& size = furniture.placeholder_size;
+            placeholder = crsf::CreateObject<crsf::TCube>(Filename(furniture.model_file).get_basename_wo_extension() + "_placeholder",
+                furniture.pos + LVecBase3f(0, 0, size[2] / 2.0f), size);
+            placeholder->CreateGraphicModel();
+            cr_world->AddWorldObject(placeholder);
+            placeholder->SetHPR(furniture.hpr[0], furniture.hpr[1], furniture.hpr[2]);
+        }
+
+        load_scene_model(furniture.model_file, [this, cr_world, furniture, placeholder](NodePath model) {
+            if (placeholder)
+                placeholder->DetachWorldObject();
+
+            // furniture has no physics model, so it is batched as graphics only.
+            if (static_batch_)
+            {
+                static_batch_->add(model, furniture.scale, furniture.pos, furniture.hpr);
+                return;
+            }
+
+            auto object = crsf::CreateObject(model);
+            cr_world->AddWorldObject(object);
+            object->SetScale(furniture.scale);
+            object->SetPosition(furniture.pos[0], furniture.pos[1], furniture.pos[2]);
+            object->SetHPR(furniture.hpr[0], furniture.hpr[1], furniture.hpr[2]);
+        });
+    }
+}
+
+void MainApp::load_scene_model(const Filename& model_file, const std::function<void(NodePath model)>& callback)
+{
+    if (!scene_loader_)
+    {
+        StartupProfiler::Scope scope(startup_profiler_.get(), "load " + model_file.get_basename());
+        NodePath model = rpcore::RPLoader::load_model(model_file.get_fullpath());
+        if (model.is_empty())
+            m_logger->error("Failed to load model: {}", model_file.get_fullpath());
+        else
+            callback(model);
+        return;
+    }
 
-    auto ikea_tullsta = crsf::CreateObject(rpcore::RPLoader::load_model("resources/models/ikea-tullsta/ikea-tullsta.bam"));
-    cr_world->AddWorldObject(ikea_tullsta);
-    ikea_tullsta->SetScale(0.075f);
-    ikea_tullsta->SetPosition(-3, 1, 0);
-    ikea_tullsta->SetHPR(35, 0, 0);
+    scene_loader_->request(model_file, [this, callback](const AvatarLoader::Result& result) {
+        const std::string name = result.model_file.get_basename();
+        StartupProfiler::Scope scope(startup_profiler_.get(), "attach " + name);
+        if (startup_profiler_)
+            startup_profiler_->add_event("load " + name, "scene " + name, result.wait_ms);
+
+        if (result.model.is_empty())
+        {
+            m_logger->error("Failed to load model: {}", result.model_file.get_fullpath());
+            return;
+        }
 
-    auto ikea_henriksdal = crsf::CreateObject(rpcore::RPLoader::load_model("resources/models/ikea-henriksdal/henriksdal.bam"));
-    cr_world->AddWorldObject(ikea_henriksdal);
-    ikea_henriksdal->SetScale(0.01f);
-    ikea_henriksdal->SetPosition(-2, -2, 0);
-    ikea_henriksdal->SetHPR(45, 0, 0);
+        m_logger->debug("Loaded model {}: decoding {:.1f} ms, waiting {:.1f} ms", name, result.decode_ms, result.wait_ms);
+        callback(result.model);
+    });
 }
 
 void MainApp::update()
 {
+    // same order as the stages of the frame graph
+    update_loaders();
+    update_tracker_filter();
+    update_ik();
+    animate_avatars();
+    update_crowd();
+    update_avatars();
+    sync_render();
+
+    if (cravatar_ik_benchmark && simple_ik_)
+        update_ik_benchmark();
+}
+
+void MainApp::update_tracker_filter()
+{
+    simulation_step_count_ = 0;
+    if (!simulation_loop_)
+        return;
+
+    // replay runs a step in each frame from loaded avatars, so that the result does not depend on the render rate.
+    if (tracker_replay_)
+    {
+        if (current_actor_ && (!avatar_loader_ || !avatar_loader_->is_busy()))
+        {
+            if (replay_joints_.empty())
+                find_replay_joints();
+            simulation_step_count_ = 1;
+        }
+    }
+    else
+    {
+        simulation_step_count_ = simulation_loop_->begin_frame(ClockObject::get_global_clock()->get_dt());
+    }
+
+    simulation_loop_->run_stages(0, simulation_input_stage_count_, simulation_step_count_);
+}
+
+void MainApp::update_ik()
+{
+    if (simulation_loop_)
+    {
+        // IK and physics of the steps whose trackers are filtered
+        simulation_loop_->run_stages(simulation_input_stage_count_, simulation_loop_->get_stages().size(), simulation_step_count_);
+        simulation_loop_->end_frame(simulation_step_count_);
+
+        if (physics_)
+            physics_->interpolate(simulation_loop_->get_alpha());
+    }
+    else if (frame_graph_ && simple_ik_ && current_actor_)
+    {
+        // otherwise, the IK is solved in its own task.
+        simple_ik_->SolveIK();
+        simple_ik_->SolveFootPlacement();
+    }
+}
+
+void MainApp::update_crowd()
+{
+    if (crowd_)
+        crowd_->update(ClockObject::get_global_clock()->get_frame_time());
+}
+
+void MainApp::sync_render()
+{
+    if (crowd_)
+        crowd_->publish();
+    if (cpu_skinning_)
+        cpu_skinning_->update();
+    if (ar_system_ && ar_system_->get_sync_event_name().empty())
+        ar_system_->sync_pose();
+}
+
+void MainApp::update_loaders()
+{
+    if (scene_loader_ && scene_loader_->is_busy())
+        scene_loader_->poll();
+
+    // static models are flattened once all of them are placed.
+    if (static_batch_ && !static_batch_->is_built() && (!scene_loader_ || !scene_loader_->is_busy()))
+        build_static_batch();
+
+    if (avatar_loader_ && avatar_loader_->is_busy())
+    {
+        avatar_loader_->poll();
+        if (!avatar_loader_->is_busy())
+        {
+            m_logger->info("Loaded avatars in {:.1f} ms (warm avatars use {:.2f} MiB)",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - avatar_load_begin_time_).count(),
+                avatar_library_->get_warm_memory() / (1024.0 * 1024.0));
+
+            if (startup_profiler_)
+                startup_profiler_->add_event("load avatars", "avatar loader", avatar_load_begin_time_, std::chrono::steady_clock::now());
+
+            if (cravatar_ik_benchmark)
+            {
+                benchmark_skeleton_pose();
+                benchmark_animation_layer();
+                benchmark_cpu_skinning();
+                benchmark_ik_threads();
+            }
+        }
+    }
+
+    // startup ends when the first frame is updated and the initial models are loaded.
+    if (startup_profiler_)
+    {
+        startup_profiler_->mark_first_frame();
+        if ((!avatar_loader_ || !avatar_loader_->is_busy()) && (!scene_loader_ || !scene_loader_->is_busy()))
+            finish_startup_profile();
+    }
+
+    // loading shows and hides avatars, so the avatars to animate are known after it.
+    collect_animated_avatars();
+}
+
+void MainApp::collect_animated_avatars()
+{
+    animated_layers_.clear();
+    animation_dt_ = ClockObject::get_global_clock()->get_dt();
+    for (size_t k = 0, k_end = avatar_library_ ? avatar_library_->size() : 0; k < k_end; ++k)
+    {
+        const auto& entry = (*avatar_library_)[k];
+        if (entry.actor && entry.animation && !entry.actor->GetNodePath().is_hidden())
+            animated_layers_.push_back(entry.animation.get());
+    }
+}
+
+void MainApp::animate_avatars()
+{
+    for (auto* layer: animated_layers_)
+        layer->animate(animation_dt_);
+}
+
+void MainApp::update_avatars()
+{
+    // write animated poses of visible avatars and update their bounds from the final joints
+    for (size_t k = 0, k_end = avatar_library_ ? avatar_library_->size() : 0; k < k_end; ++k)
+    {
+        const auto& entry = (*avatar_library_)[k];
+        if (!entry.actor || entry.actor->GetNodePath().is_hidden())
+            continue;
+
+        if (entry.animation)
+            entry.animation->apply();
+
+        if (entry.bounds)
+        {
+            if (entry.animation)
+                entry.bounds->update(entry.animation->get_pose());
+            else
+                entry.bounds->update();
+        }
+    }
+}
+
+void MainApp::update_ik_benchmark()
+{
+    // move the arm target around the right shoulder (unit of actor is cm)
+    const float angle = ik_benchmark_frame_ * 2.0f * MathNumbers::pi_f / ik_benchmark_frame_count;
+    if (current_actor_)
+    {
+        trackers_[0].set_pos(current_actor_->GetNodePath(),
+            LPoint3f(25.0f + 30.0f * std::cos(angle), -30.0f, 120.0f + 30.0f * std::sin(angle)));
+    }
+    move_ik_targets(angle);
+
+    const auto& stats = simple_ik_->GetStatistics();
+    ik_benchmark_query_ms_ += stats.foot_query_ms;
+    ik_benchmark_solve_ms_ += stats.foot_solve_ms;
+    ik_benchmark_joint_writes_ += stats.joint_writes + stats.foot_joint_writes;
+    ik_benchmark_joint_writes_skipped_ += stats.joint_writes_skipped + stats.foot_joint_writes_skipped;
+    if (++ik_benchmark_frame_ == ik_benchmark_frame_count)
+    {
+        m_logger->info("Foot IK: {} feet ({} hits), query {:.3f} ms, solve {:.3f} ms (average of {} frames)",
+            stats.foot_count, stats.foot_hit_count, ik_benchmark_query_ms_ / ik_benchmark_frame_count,
+            ik_benchmark_solve_ms_ / ik_benchmark_frame_count, ik_benchmark_frame_count);
+        m_logger->info("Arm IK (pole {}): {} arms, {:.2f} iterations on average",
+            simple_ik_->IsPoleEnabled() ? "on" : "off", stats.arm_count,
+            stats.total_solves ? static_cast<double>(stats.total_iterations) / stats.total_solves : 0.0);
+        m_logger->info("IK joint writes: {:.1f} per frame, {:.1f} avoided per frame",
+            ik_benchmark_joint_writes_ / static_cast<double>(ik_benchmark_frame_count),
+            ik_benchmark_joint_writes_skipped_ / static_cast<double>(ik_benchmark_frame_count));
+
+        log_joint_update_time();
+        check_animated_bounds();
+
+        // compare iterations with and without the pole in turn
+        simple_ik_->SetPoleEnabled(!simple_ik_->IsPoleEnabled());
+        simple_ik_->ResetStatistics();
+
+        ik_benchmark_frame_ = 0;
+        ik_benchmark_query_ms_ = 0;
+        ik_benchmark_solve_ms_ = 0;
+        ik_benchmark_joint_writes_ = 0;
+        ik_benchmark_joint_writes_skipped_ = 0;
+    }
+}
+
+void MainApp::move_ik_targets(float angle)
+{
+    // move arm targets around right shoulders in different phases (unit of actor is cm)
+    for (size_t k = 0, k_end = avatar_library_->size(); k < k_end; ++k)
+    {
+        const auto& entry = (*avatar_library_)[k];
+        if (!entry.ik_target)
+            continue;
+
+        const float phase = angle + static_cast<float>(k);
+        entry.ik_target.set_pos(LPoint3f(25.0f + 30.0f * std::cos(phase), -30.0f, 120.0f + 30.0f * std::sin(phase)));
+    }
+}
+
+void MainApp::log_joint_update_time()
+{
+    std::vector<Character*> characters;
+    for (size_t k = 0, k_end = avatar_library_->size(); k < k_end; ++k)
+    {
+        const auto& entry = (*avatar_library_)[k];
+        if (!entry.actor)
+            continue;
+
+        const NodePathCollection nps = entry.actor->GetNodePath().find_all_matches("**/+Character");
+        for (int i = 0, i_end = nps.get_num_paths(); i < i_end; ++i)
+            characters.push_back(DCAST(Character, nps.get_path(i).node()));
+    }
+
+    // force_update() ignores the frame cache, so it measures the full update of joints and their nodes.
+    static const int repeat_count = 10;
+    const auto begin_time = std::chrono::steady_clock::now();
+    for (int k = 0; k < repeat_count; ++k)
+    {
+        for (auto* character: characters)
+            character->force_update();
+    }
+    const double update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count() / repeat_count;
+
+    m_logger->info("Joint update ({} control joints): {:.3f} ms for {} characters",
+        cravatar_selective_control_joints ? "selective" : "all", update_ms, characters.size());
+}
+
+void MainApp::check_animated_bounds()
+{
+    float undershoot = 0.0f;
+    size_t avatar_count = 0;
+    for (size_t k = 0, k_end = avatar_library_->size(); k < k_end; ++k)
+    {
+        const auto& entry = (*avatar_library_)[k];
+        if (!entry.bounds || entry.actor->GetNodePath().is_hidden())
+            continue;
+
+        undershoot = (std::max)(undershoot, entry.bounds->measure_undershoot());
+        ++avatar_count;
+    }
+
+    // CPU skinning rounds differently from the bounds, so a miss below 0.01 cm is ignored.
+    if (undershoot > 0.01f)
+        m_logger->error("Animated bounds miss skinned vertices by {:.3f} cm ({} avatars)", undershoot, avatar_count);
+    else
+        m_logger->info("Animated bounds contain skinned vertices of {} avatars", avatar_count);
+}
+
+void MainApp::benchmark_skeleton_pose()
+{
+    const SkeletonIndex* skeleton = nullptr;
+    NodePath actor_np;
+    for (size_t k = 0, k_end = avatar_library_->size(); k < k_end && !skeleton; ++k)
+    {
+        const auto& entry = (*avatar_library_)[k];
+        skeleton = entry.skeleton.get();
+        if (skeleton && entry.actor)
+            actor_np = entry.actor->GetNodePath();
+    }
+
+    if (!skeleton)
+    {
+        m_logger->warn("Skeleton pose benchmark needs a skeleton index. Set cravatar-asset-cache-dir.");
+        return;
+    }
+
+    static const int frame_count = 100;
+    const SkeletonPose bind_pose(*skeleton);
+    const size_t joint_count = bind_pose.get_joint_count();
+
+    // poses publish to copies of the actor, so that they write characters like the nodes are written.
+    std::unordered_set<std::string> joint_names;
+    for (size_t k = 0; k < joint_count; ++k)
+        joint_names.insert(bind_pose.get_name(k));
+
+    for (const size_t avatar_count: { 1, 10, 50, 100 })
+    {
+        // a node per joint like control joints
+        NodePath root("SkeletonPoseBenchmark");
+        std::vector<std::vector<NodePath>> node_skeletons(avatar_count);
+        for (auto&& joints: node_skeletons)
+        {
+            NodePath avatar_np = root.attach_new_node("avatar");
+            for (size_t k = 0; k < joint_count; ++k)
+            {
+                const int parent = bind_pose.get_parent(k);
+                joints.push_back((parent < 0 ? avatar_np : joints[parent]).attach_new_node(new ModelNode(bind_pose.get_name(k))));
+                joints.back().set_pos(bind_pose.get_local_pos(k));
+                joints.back().set_quat(bind_pose.get_local_quat(k));
+            }
+        }
+
+        std::vector<SkeletonPose> poses(avatar_count, bind_pose);
+        if (actor_np)
+        {
+            for (auto&& pose: poses)
+            {
+                NodePath character_np = actor_np.copy_to(root).find("**/+Character");
+                if (character_np)
+                    pose.bind(DCAST(Character, character_np.node()), joint_names);
+            }
+        }
+
+        double node_ms = 0;
+        double pose_ms = 0;
+        double publish_ms = 0;
+        LMatrix4f checksum = LMatrix4f::zeros_mat();
+        for (int frame = 0; frame < frame_count; ++frame)
+        {
+            LQuaternionf delta;
+            delta.set_hpr(LVecBase3f(frame * 0.1f, 0, 0));
+
+            auto begin_time = std::chrono::steady_clock::now();
+            for (const auto& joints: node_skeletons)
+            {
+                for (size_t k = 0; k < joint_count; ++k)
+                    joints[k].set_quat(bind_pose.get_local_quat(k) * delta);
+                for (size_t k = 0; k < joint_count; ++k)
+                    checksum += joints[k].get_net_transform()->get_mat();
+            }
+            auto end_time = std::chrono::steady_clock::now();
+            node_ms += std::chrono::duration<double, std::milli>(end_time - begin_time).count();
+
+            begin_time = std::chrono::steady_clock::now();
+            for (auto&& pose: poses)
+            {
+                for (size_t k = 0; k < joint_count; ++k)
+                    pose.set_local_quat(k, bind_pose.get_local_quat(k) * delta);
+                pose.compute_world();
+                for (size_t k = 0; k < joint_count; ++k)
+                    checksum += pose.get_world(k);
+            }
+            end_time = std::chrono::steady_clock::now();
+            pose_ms += std::chrono::duration<double, std::milli>(end_time - begin_time).count();
+
+            begin_time = std::chrono::steady_clock::now();
+            for (auto&& pose: poses)
+                pose.publish();
+            end_time = std::chrono::steady_clock::now();
+            publish_ms += std::chrono::duration<double, std::milli>(end_time - begin_time).count();
+        }
+
+        m_logger->info("Skeleton pose ({} joints x {} avatars): NodePath {:.3f} ms, SoA {:.3f} ms + publish {:.3f} ms ({} joints) per frame (checksum {})",
+            joint_count, avatar_count, node_ms / frame_count, pose_ms / frame_count, publish_ms / frame_count,
+            poses.front().get_published_count(), checksum(3, 3));
+    }
+}
+
+void MainApp::setup_animation_clips(AvatarLibrary::Entry& entry)
+{
+    const std::pair<AnimationLayer::Slot, std::string> clip_names[] = {
+        { AnimationLayer::Slot::idle, "idle" },
+        { AnimationLayer::Slot::locomotion, "walk" },
+    };
+
+    for (const auto& slot_name: clip_names)
+    {
+        // compressed clip is preferred.
+        std::shared_ptr<AnimationClip> clip;
+        for (const auto& extension: { "crclip", "bam", "egg" })
+        {
+            auto iter = std::find_if(entry.clip_files.begin(), entry.clip_files.end(), [&](const Filename& file) {
+                return file.get_basename_wo_extension() == slot_name.second && file.get_extension() == extension;
+            });
+            if (iter == entry.clip_files.end())
+                continue;
+
+            if (iter->get_extension() == "crclip")
+                clip = AnimationClip::read(*iter, entry.animation->get_pose());
+            else if (asset_cache_)
+                clip = asset_cache_->load_clip(*iter, entry.animation->get_pose());
+            else
+                clip = AnimationClip::load(*iter, entry.animation->get_pose());
+
+            if (clip)
+                break;
+        }
+
+        if (!clip && slot_name.first == AnimationLayer::Slot::idle)
+            clip = AnimationClip::make_idle(entry.animation->get_pose());
+
+        if (clip)
+        {
+            m_logger->debug("Animation clip {} of {}: {} tracks, {} of {} frames, {:.1f} KiB (raw {:.1f} KiB)",
+                slot_name.second, entry.name, clip->get_track_count(), clip->get_key_count(), clip->get_frame_count(),
+                clip->get_memory_usage() / 1024.0,
+                clip->get_frame_count() * clip->get_track_count() * AnimationClip::key_size * sizeof(float) / 1024.0);
+            entry.animation->set_clip(slot_name.first, clip);
+        }
+    }
+}
+
+void MainApp::benchmark_animation_layer()
+{
+    const SkeletonIndex* skeleton = nullptr;
+    for (size_t k = 0, k_end = avatar_library_->size(); k < k_end && !skeleton; ++k)
+        skeleton = (*avatar_library_)[k].skeleton.get();
+
+    if (!skeleton)
+        return;
+
+    // layers are not bound, so it measures sampling and blending only.
+    static const int frame_count = 100;
+    const SkeletonPose bind_pose(*skeleton);
+    std::shared_ptr<const AnimationClip> clip = AnimationClip::make_idle(bind_pose);
+
+    for (const size_t avatar_count: { 10, 100, 500 })
+    {
+        std::vector<std::unique_ptr<AnimationLayer>> layers;
+        for (size_t k = 0; k < avatar_count; ++k)
+        {
+            layers.push_back(std::make_unique<AnimationLayer>(*skeleton));
+            layers.back()->set_clip(AnimationLayer::Slot::idle, clip);
+            layers.back()->set_clip(AnimationLayer::Slot::locomotion, clip);
+            layers.back()->set_locomotion_weight(0.5f);
+        }
+
+        const auto begin_time = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frame_count; ++frame)
+        {
+            for (auto&& layer: layers)
+                layer->update(1.0 / 60.0);
+        }
+        const double update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count() / frame_count;
+
+        m_logger->info("Animation layer ({} joints x {} avatars): {:.3f} ms per frame",
+            bind_pose.get_joint_count(), avatar_count, update_ms);
+    }
+}
+
+void MainApp::benchmark_cpu_skinning()
+{
+    if (cpu_skinning_)
+    {
+        m_logger->warn("CPU skinning benchmark needs meshes animated by Panda3D. Unset cravatar-cpu-skinning.");
+        return;
+    }
+
+    // skinned vertices are written to copies of vertex data which are not rendered.
+    static const int frame_count = 20;
+    const int core_count = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int thread_count = 1; ; thread_count = (std::min)(thread_count * 2, core_count))
+    {
+        CpuSkinning skinning(thread_count);
+        for (size_t k = 0, k_end = avatar_library_->size(); k < k_end; ++k)
+        {
+            const auto& entry = (*avatar_library_)[k];
+            if (entry.actor)
+                skinning.add_meshes(entry.actor->GetNodePath(), false);
+        }
+
+        if (skinning.get_vertex_count() == 0)
+            return;
+
+        skinning.update();
+
+        const auto begin_time = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frame_count; ++frame)
+            skinning.update();
+        const double update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count() / frame_count;
+
+        m_logger->info("CPU skinning ({} vertices, {} threads): {:.3f} ms per frame, {:.0f} vertices/ms",
+            skinning.get_vertex_count(), thread_count, update_ms, skinning.get_vertex_count() / update_ms);
+
+        if (thread_count == core_count)
+            break;
+    }
+}
+
+void MainApp::benchmark_ik_threads()
+{
+    if (!simple_ik_)
+        return;
+
+    // targets are moved in every frame, so solvers are not converged at start.
+    static const int frame_count = 100;
+    const int core_count = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+    double single_thread_ms = 0;
+    for (int thread_count = 1; ; thread_count = (std::min)(thread_count * 2, core_count))
+    {
+        simple_ik_->SetThreadCount(thread_count);
+
+        const auto begin_time = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frame_count; ++frame)
+        {
+            move_ik_targets(frame * 2.0f * MathNumbers::pi_f / frame_count);
+            simple_ik_->SolveIK();
+        }
+        const double solve_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count() / frame_count;
+        if (thread_count == 1)
+            single_thread_ms = solve_ms;
+
+        m_logger->info("Arm IK ({} arms, {} threads): {:.3f} ms per frame, {:.2f}x of a thread",
+            simple_ik_->GetStatistics().arm_count, thread_count, solve_ms, single_thread_ms / solve_ms);
+
+        if (thread_count == core_count)
+            break;
+    }
+
+    simple_ik_->SetThreadCount(cravatar_ik_threads);
+    simple_ik_->ResetStatistics();
+}
+
+void MainApp::build_static_batch()
+{
+    StartupProfiler::Scope scope(startup_profiler_.get(), "StaticBatch::build");
+
+    const NodePath camera = rpcore::Globals::base->get_cam();
+    const auto before = static_batch_->analyze(camera);
+
+    const auto begin_time = std::chrono::steady_clock::now();
+    static_batch_->build();
+    const double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+
+    const auto after = static_batch_->analyze(camera);
+
+    m_logger->info("Static batch: nodes {} -> {}, geom nodes {} -> {}, geoms {} -> {}, frustum test {:.3f} -> {:.3f} ms per frame (built in {:.1f} ms)",
+        before.node_count, after.node_count, before.geom_node_count, after.geom_node_count, before.geom_count, after.geom_count,
+        before.cull_ms, after.cull_ms, build_ms);
+}
+
+void MainApp::finish_startup_profile()
+{
+    startup_profiler_->log_summary(*m_logger);
+
+    const Filename trace_file = cravatar_startup_trace.get_value();
+    if (!trace_file.empty())
+    {
+        if (startup_profiler_->write_trace(trace_file))
+            m_logger->info("Wrote startup trace: {}", trace_file.to_os_specific());
+        else
+            m_logger->warn("Failed to write startup trace: {}", trace_file.to_os_specific());
+    }
+
+    startup_profiler_.reset();
 }
 
 void MainApp::change_actor(crsf::TActorObject* new_actor)
 {
+    const auto begin_time = std::chrono::steady_clock::now();
+
+    // feet of hidden actors are not placed.
     if (current_actor_)
         current_actor_->Hide();
 
@@ -202,10 +1421,20 @@ void MainApp::change_actor(crsf::TActorObject* new_actor)
 
     if (simple_ik_)
     {
-        simple_ik_->SetActor(current_actor_);
-        simple_ik_->SetEndEffector(trackers_[0]);
-        simple_ik_->StartSolveIKLoop();
+        const auto* entry = current_avatar_ < avatar_library_->size() ? &(*avatar_library_)[current_avatar_] : nullptr;
+        if (cravatar_ik_avatar_memory && entry && entry->memory_object)
+            simple_ik_->SetAvatarMemoryObject(entry->memory_object, entry->memory_layout->get_joint_names());
+        else
+            simple_ik_->SetActor(current_actor_);
+
+        // the simulation loop solves the IK at its own rate, and the frame graph solves it in its stage.
+        simple_ik_->SetEndEffector(simulation_loop_ ? ik_target_ : trackers_[0]);
+        if (!simulation_loop_ && !frame_graph_)
+            simple_ik_->StartSolveIKLoop();
     }
 
     current_actor_->Show();
+
+    actor_switch_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+    m_logger->debug("Switched actor in {:.3f} ms", actor_switch_ms_);
 }
@@ -5,6 +5,15 @@
 
 #include <nodePath.h>
 
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <limits>
+
+#include "avatar/avatar_library.hpp"
+#include "avatar/avatar_loader.hpp"
+#include "tracker_recording.hpp"
+
 namespace rpcore {
 class RenderPipeline;
 }
@@ -16,9 +25,18 @@ class TAvatarMemoryObject;
 }
 
 class Floor;
+class AnimationLayer;
+class AssetCache;
+class CpuSkinning;
+class Crowd;
 class OpenVRManager;
 class ARSystem;
 class SimpleIKModule;
+class StartupProfiler;
+class StaticBatch;
+class FixedStepPhysics;
+class SimulationLoop;
+class FrameGraph;
 
 class MainApp : public crsf::TDynamicModuleInterface, public rppanda::DirectObject
 {
@@ -34,13 +52,46 @@ public:
     void setup_ik();
     void setup_avatar();
     void setup_chair();
+    void setup_simulation();
+    void setup_simulation_ik();
+    void setup_frame_graph();
 
+    /** Update stages in order if the frame graph is disabled. */
     void update();
+    void update_loaders();
+    void collect_animated_avatars();
+    void update_tracker_filter();
+    void update_ik();
+    void animate_avatars();
+    void update_crowd();
+    void update_avatars();
+    void sync_render();
+    void update_ik_benchmark();
 
 private:
     friend class MainGUI;
 
+    void load_avatar(size_t index);
+    void add_avatar(size_t index, const AvatarLoader::Result& result);
+    void write_memory_bind_pose(AvatarLibrary::Entry& entry);
+    void select_avatar(size_t index);
+    void evict_avatars();
+    void log_joint_update_time();
+    void check_animated_bounds();
+    void benchmark_skeleton_pose();
+    void benchmark_animation_layer();
+    void benchmark_cpu_skinning();
+    void benchmark_ik_threads();
+    void move_ik_targets(float angle);
+    void setup_animation_clips(AvatarLibrary::Entry& entry);
     void change_actor(crsf::TActorObject* new_actor);
+    void finish_startup_profile();
+    void build_static_batch();
+    void find_replay_joints();
+    void finish_replay();
+
+    /** Load the model on the scene loader, or synchronously if it is disabled. */
+    void load_scene_model(const Filename& model_file, const std::function<void(NodePath model)>& callback);
 
     crsf::TGraphicRenderEngine* rendering_engine_;
     rpcore::RenderPipeline* pipeline_;
@@ -49,12 +100,52 @@ private:
     std::unique_ptr<ARSystem> ar_system_;
 
     std::unique_ptr<Floor> floor_;
-    std::vector<std::shared_ptr<crsf::TActorObject>> actors_;
+    std::unique_ptr<StaticBatch> static_batch_;             // null if static models are not batched
+    std::unique_ptr<AvatarLoader> avatar_loader_;
+    std::unique_ptr<AvatarLoader> scene_loader_;            // models of the scene except avatars
+    std::chrono::steady_clock::time_point avatar_load_begin_time_;
+    std::unique_ptr<AvatarLibrary> avatar_library_;
+    std::unique_ptr<AssetCache> asset_cache_;
+    std::unique_ptr<Crowd> crowd_;
+    std::unique_ptr<CpuSkinning> cpu_skinning_;
+    size_t current_avatar_ = std::numeric_limits<size_t>::max();
+    size_t pending_avatar_ = std::numeric_limits<size_t>::max();
     crsf::TActorObject* current_actor_ = nullptr;
+    double actor_switch_ms_ = 0;
+    std::vector<AnimationLayer*> animated_layers_;          // visible avatars in the current frame
+    double animation_dt_ = 0;
 
     NodePath trackers_[2];
 
+    // tracker sampling, filtering, IK and physics at a fixed rate
+    std::unique_ptr<SimulationLoop> simulation_loop_;       // null if the IK is solved in its own task
+    std::unique_ptr<FixedStepPhysics> physics_;             // null if the physics steps in its own tasks
+    std::unique_ptr<TrackerRecording> tracker_recording_;   // samples to record, or to replay
+    bool tracker_replay_ = false;
+    TrackerRecording::Sample tracker_sample_;
+    TrackerRecording::Sample filtered_tracker_;
+    bool filtered_tracker_valid_ = false;
+    std::deque<TrackerRecording::Sample> filtered_targets_; // filtered trackers of steps whose IK is not solved yet
+    NodePath ik_target_;                                    // filtered tracker
+    size_t simulation_input_stage_count_ = 0;               // stages of sampling and filtering
+    int simulation_step_count_ = 0;                         // steps of the current frame
+    size_t replay_step_ = 0;
+    std::vector<NodePath> replay_joints_;
+    uint64_t replay_hash_ = 14695981039346656037ull;
+
     SimpleIKModule* simple_ik_ = nullptr;
 
+    // statistics of the IK benchmark which are logged every ik_benchmark_frame_count frames
+    static constexpr int ik_benchmark_frame_count = 300;
+    int ik_benchmark_frame_ = 0;
+    double ik_benchmark_query_ms_ = 0;
+    double ik_benchmark_solve_ms_ = 0;
+    size_t ik_benchmark_joint_writes_ = 0;
+    size_t ik_benchmark_joint_writes_skipped_ = 0;
+
+    std::unique_ptr<FrameGraph> frame_graph_;               // null if the frame is updated in separate tasks
+
     std::unique_ptr<MainGUI> main_gui_;
+
+    std::unique_ptr<StartupProfiler> startup_profiler_;    // null after the startup
 };
@@ -10,6 +10,14 @@
 
 #include <crsf/CRModel/TActorObject.h>
 
+#include "simple_ik/module.h"
+
+#include "avatar/animation_layer.hpp"
+#include "avatar/avatar_library.hpp"
+#include "frame_graph.hpp"
+#include "fixed_step_physics.hpp"
+#include "simulation_loop.hpp"
+
 #include "main.hpp"
 
 MainGUI::MainGUI(MainApp& app) : app_(app)
@@ -34,23 +42,118 @@ void MainGUI::on_imgui_new_frame()
 
     static ImGuiComboFlags comobo_flags = 0;
     static std::string actor_name;
-    if (app_.current_actor_)
-        actor_name = app_.current_actor_->GetName();
+    if (!app_.avatar_library_)
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (app_.current_avatar_ < app_.avatar_library_->size())
+        actor_name = (*app_.avatar_library_)[app_.current_avatar_].name;
     if (ImGui::BeginCombo("Actors", actor_name.c_str(), comobo_flags))
     {
-        for (const auto& actor : app_.actors_)
+        auto& library = *app_.avatar_library_;
+        for (size_t k = 0, k_end = library.size(); k < k_end; ++k)
         {
-            bool is_selected = (app_.current_actor_ == actor.get());
+            const auto& entry = library[k];
+            bool is_selected = (app_.current_avatar_ == k);
+
+            std::string label;
+            if (entry.actor)
+                label = fmt::format("{} ({:.1f} MiB)###{}", entry.name, app_.avatar_library_->get_memory(k) / (1024.0 * 1024.0), k);
+            else if (entry.loading)
+                label = fmt::format("{} (loading)###{}", entry.name, k);
+            else
+                label = fmt::format("{}###{}", entry.name, k);
+
+            if (ImGui::Selectable(label.c_str(), is_selected))
+                app_.select_avatar(k);
 
-            auto id = fmt::format("{}###{}", actor->GetName(), (void*)actor.get());
-            if (ImGui::Selectable(id.c_str(), is_selected))
-                app_.change_actor(actor.get());
+            if (entry.thumbnail && ImGui::IsItemHovered())
+            {
+                ImGui::BeginTooltip();
+                ImGui::Image(entry.thumbnail.p(), ImVec2(128, 128));
+                ImGui::EndTooltip();
+            }
 
             if (is_selected)
                 ImGui::SetItemDefaultFocus();   // Set the initial focus when opening the combo (scrolling + for keyboard navigation support in the upcoming navigation branch)
         }
         ImGui::EndCombo();
     }
+    ImGui::Text("Warm avatars: %.1f MiB", app_.avatar_library_->get_warm_memory() / (1024.0 * 1024.0));
+    ImGui::Text("Actor switch: %.3f ms", app_.actor_switch_ms_);
+    if (app_.physics_ && app_.physics_->is_running())
+        ImGui::Text("Physics step: %.3f ms (%d bodies)", app_.physics_->get_step_ms(), static_cast<int>(app_.physics_->get_body_count()));
+    if (app_.frame_graph_)
+    {
+        ImGui::Text("Frame graph: %.3f ms (%d threads)", app_.frame_graph_->get_frame_ms(), app_.frame_graph_->get_thread_count());
+        for (const auto& stage: app_.frame_graph_->get_stages())
+            ImGui::Text("  %s: %.3f ms at %.3f ms", stage.name.c_str(), stage.ms, stage.begin_ms);
+    }
+    if (app_.simulation_loop_)
+    {
+        ImGui::Text("Simulation: %.0f Hz (%d steps dropped)", app_.simulation_loop_->get_rate(),
+            static_cast<int>(app_.simulation_loop_->get_dropped_step_count()));
+        for (const auto& stage: app_.simulation_loop_->get_stages())
+            ImGui::Text("  %s: %.3f ms", stage.name.c_str(), stage.ms);
+    }
+
+    if (app_.current_avatar_ < app_.avatar_library_->size())
+    {
+        const auto& animation = (*app_.avatar_library_)[app_.current_avatar_].animation;
+        float locomotion_weight = animation ? animation->get_locomotion_weight() : 0.0f;
+        if (animation && ImGui::SliderFloat("Locomotion", &locomotion_weight, 0.0f, 1.0f))
+            animation->set_locomotion_weight(locomotion_weight);
+        if (animation)
+        {
+            ImGui::Text("Animated joints: %d written, %d unchanged",
+                static_cast<int>(animation->get_write_count()), static_cast<int>(animation->get_skipped_count()));
+        }
+    }
+
+    if (app_.simple_ik_ && ImGui::CollapsingHeader("Simple IK"))
+    {
+        bool self_collision = app_.simple_ik_->IsSelfCollisionEnabled();
+        if (ImGui::Checkbox("Self collision", &self_collision))
+            app_.simple_ik_->SetSelfCollisionEnabled(self_collision);
+
+        bool pole = app_.simple_ik_->IsPoleEnabled();
+        if (ImGui::Checkbox("Pole vector", &pole))
+            app_.simple_ik_->SetPoleEnabled(pole);
+
+        bool pose_cache = app_.simple_ik_->IsPoseCacheEnabled();
+        if (ImGui::Checkbox("Pose cache", &pose_cache))
+            app_.simple_ik_->SetPoseCacheEnabled(pose_cache);
+        ImGui::SameLine();
+        if (ImGui::Button("Clear cache"))
+            app_.simple_ik_->ClearPoseCache();
+
+        const auto& stats = app_.simple_ik_->GetStatistics();
+        ImGui::Text("Arm solve: %.3f ms (%d arms, %d threads)", stats.solve_ms,
+            static_cast<int>(stats.arm_count), app_.simple_ik_->GetThreadCount());
+        ImGui::Text("Arm iterations: %d (average %.2f)", stats.iterations,
+            stats.total_solves ? static_cast<double>(stats.total_iterations) / stats.total_solves : 0.0);
+        ImGui::Text("Self collision: %.3f ms (%d contacts)", stats.self_collision_ms, static_cast<int>(stats.self_collision_contacts));
+        ImGui::Text("Feet: %d (%d on ground)", static_cast<int>(stats.foot_count), static_cast<int>(stats.foot_hit_count));
+        ImGui::Text("Foot ground query: %.3f ms", stats.foot_query_ms);
+        ImGui::Text("Foot solve: %.3f ms", stats.foot_solve_ms);
+        ImGui::Text("Joint writes: %d (%d skipped)",
+            static_cast<int>(stats.joint_writes + stats.foot_joint_writes),
+            static_cast<int>(stats.joint_writes_skipped + stats.foot_joint_writes_skipped));
+
+        const size_t cache_lookups = stats.cache_exact_hits + stats.cache_near_hits + stats.cache_misses;
+        if (cache_lookups > 0)
+        {
+            ImGui::Text("Pose cache: %.1f %% exact, %.1f %% near, %.1f KiB",
+                100.0 * stats.cache_exact_hits / cache_lookups,
+                100.0 * stats.cache_near_hits / cache_lookups,
+                stats.cache_memory / 1024.0);
+        }
+
+        if (ImGui::Button("Reset statistics"))
+            app_.simple_ik_->ResetStatistics();
+    }
 
     ImGui::End();
 }
@@ -1,5 +1,8 @@
 #include "floor.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include <render_pipeline/rpcore/util/rpmaterial.hpp>
 #include <render_pipeline/rpcore/util/rpgeomnode.hpp>
 
@@ -43,4 +46,60 @@ void Floor::setup_physics()
     params.m_fFriction = 10.0f;
     floor_->CreatePhysicsModel(params);
     crsf::TPhysicsManager::GetInstance()->AddModel(floor_);
+
+    NodePath np = floor_->GetNodePath();
+    np.calc_tight_bounds(bounds_min_, bounds_max_, np.get_top());
+}
+
+void Floor::raycast(const std::vector<GroundRay>& rays, std::vector<GroundHit>& hits) const
+{
+    hits.resize(rays.size());
+
+    // slab test of the axis-aligned floor box
+    for (size_t k = 0, k_end = rays.size(); k < k_end; ++k)
+    {
+        const LPoint3f& from = rays[k].from;
+        const LVector3f dir = rays[k].to - from;
+        auto& hit = hits[k];
+
+        float t_min = 0.0f;
+        float t_max = 1.0f;
+        int hit_axis = -1;
+        hit.hit = true;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (std::abs(dir[axis]) < 1e-6f)
+            {
+                if (from[axis] < bounds_min_[axis] || from[axis] > bounds_max_[axis])
+                    hit.hit = false;
+                continue;
+            }
+
+            float t0 = (bounds_min_[axis] - from[axis]) / dir[axis];
+            float t1 = (bounds_max_[axis] - from[axis]) / dir[axis];
+            if (t0 > t1)
+                std::swap(t0, t1);
+
+            if (t0 > t_min)
+            {
+                t_min = t0;
+                hit_axis = axis;
+            }
+            t_max = (std::min)(t_max, t1);
+        }
+
+        if (!hit.hit || t_min > t_max)
+        {
+            hit.hit = false;
+            continue;
+        }
+
+        hit.position = from + dir * t_min;
+        hit.normal = LVector3f::up();
+        if (hit_axis != -1)
+        {
+            hit.normal = LVector3f::zero();
+            hit.normal[hit_axis] = dir[hit_axis] > 0 ? -1.0f : 1.0f;
+        }
+    }
 }
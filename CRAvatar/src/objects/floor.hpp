@@ -4,6 +4,8 @@
 
 #include <memory>
 
+#include "simple_ik/ground_query.h"
+
 namespace crsf {
 class TCube;
 }
@@ -19,8 +21,13 @@ public:
 
     crsf::TCube* get_object() const;
 
+    /** Cast all rays against the box of the physics model at once. */
+    void raycast(const std::vector<GroundRay>& rays, std::vector<GroundHit>& hits) const;
+
 private:
     std::shared_ptr<crsf::TCube> floor_;
+    LPoint3f bounds_min_;
+    LPoint3f bounds_max_;
 };
 
 inline crsf::TCube* Floor::get_object() const
@@ -0,0 +1,86 @@
+#include "static_batch.hpp"
+
+#include <chrono>
+
+#include <camera.h>
+#include <geometricBoundingVolume.h>
+#include <lens.h>
+#include <sceneGraphAnalyzer.h>
+
+namespace {
+
+// test bounds of the node and its children against the frustum like the cull traverser.
+void test_frustum(PandaNode* node, const TransformState* parent_net, const GeometricBoundingVolume* frustum)
+{
+    CPT(TransformState) net = parent_net->compose(node->get_transform());
+
+    PT(GeometricBoundingVolume) bounds = DCAST(GeometricBoundingVolume, node->get_bounds()->make_copy());
+    bounds->xform(net->get_mat());
+    if (frustum->contains(bounds) == BoundingVolume::IF_no_intersection)
+        return;
+
+    PandaNode::Children children = node->get_children();
+    for (size_t k = 0, k_end = children.get_num_children(); k < k_end; ++k)
+        test_frustum(children.get_child(k), net, frustum);
+}
+
+}
+
+StaticBatch::StaticBatch(NodePath parent, const std::string& name)
+{
+    root_ = parent.attach_new_node(name);
+}
+
+StaticBatch::~StaticBatch()
+{
+    root_.remove_node();
+}
+
+NodePath StaticBatch::add(NodePath model, float scale, const LVecBase3f& pos, const LVecBase3f& hpr)
+{
+    model.reparent_to(root_);
+    model.set_scale(scale);
+    model.set_pos(pos);
+    model.set_hpr(hpr);
+
+    built_ = false;
+
+    return model;
+}
+
+void StaticBatch::build()
+{
+    // model roots stop flattening, so they are removed first.
+    root_.clear_model_nodes();
+    root_.flatten_strong();
+
+    built_ = true;
+}
+
+StaticBatch::Statistics StaticBatch::analyze(NodePath camera) const
+{
+    Statistics stats;
+
+    SceneGraphAnalyzer analyzer;
+    analyzer.add_node(root_.node());
+    stats.node_count = analyzer.get_num_nodes();
+    stats.geom_node_count = analyzer.get_num_geom_nodes();
+    stats.geom_count = analyzer.get_num_geoms();
+
+    Camera* camera_node = camera.is_empty() ? nullptr : DCAST(Camera, camera.node());
+    Lens* lens = camera_node ? camera_node->get_lens() : nullptr;
+    if (!lens)
+        return stats;
+
+    PT(BoundingVolume) lens_bounds = lens->make_bounds();
+    const GeometricBoundingVolume* frustum = DCAST(GeometricBoundingVolume, lens_bounds);
+    CPT(TransformState) parent_net = root_.get_parent().get_transform(camera);
+
+    static const int repeat_count = 100;
+    const auto begin_time = std::chrono::steady_clock::now();
+    for (int k = 0; k < repeat_count; ++k)
+        test_frustum(root_.node(), parent_net, frustum);
+    stats.cull_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count() / repeat_count;
+
+    return stats;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <nodePath.h>
+
+/**
+ * Static models of the scene which are flattened and merged by render state.
+ *
+ * Models are placed under the batch with their transforms, and build() bakes the transforms into
+ * vertices and merges geometry of the same state, so the cull traversal visits a few geom nodes
+ * instead of the original hierarchies. Physics models are kept outside of the batch.
+ */
+class StaticBatch
+{
+public:
+    struct Statistics
+    {
+        int node_count = 0;
+        int geom_node_count = 0;
+        int geom_count = 0;
+        double cull_ms = 0;             // frustum test of all nodes like the cull traversal
+    };
+
+    StaticBatch(NodePath parent, const std::string& name = "static_batch");
+    ~StaticBatch();
+
+    NodePath add(NodePath model, float scale, const LVecBase3f& pos, const LVecBase3f& hpr);
+
+    /** Flatten models added so far. Models added after it are flattened in the next build. */
+    void build();
+
+    bool is_built() const;
+    NodePath get_root() const;
+
+    /** Count nodes under the batch and measure the frustum test of them with the lens of @a camera. */
+    Statistics analyze(NodePath camera) const;
+
+private:
+    NodePath root_;
+    bool built_ = false;
+};
+
+// ************************************************************************************************
+
+inline bool StaticBatch::is_built() const
+{
+    return built_;
+}
+
+inline NodePath StaticBatch::get_root() const
+{
+    return root_;
+}
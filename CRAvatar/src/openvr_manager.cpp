@@ -25,7 +25,7 @@
 
 extern spdlog::logger* global_logger;
 
-OpenVRManager::OpenVRManager(rpcore::RenderPipeline& pipeline) : pipeline_(pipeline)
+OpenVRManager::OpenVRManager(rpcore::RenderPipeline& pipeline, bool event_task) : pipeline_(pipeline)
 {
     if (!pipeline_.get_plugin_mgr()->is_plugin_enabled("openvr"))
         return;
@@ -38,10 +38,13 @@ OpenVRManager::OpenVRManager(rpcore::RenderPipeline& pipeline) : pipeline_(pipel
 
     toggle_ar();
 
-    add_task([this](rppanda::FunctionalTask*) {
-        process_controller_event();
-        return AsyncTask::DoneStatus::DS_cont;
-    }, "process_controller_event");
+    if (event_task)
+    {
+        add_task([this](rppanda::FunctionalTask*) {
+            process_controller_event();
+            return AsyncTask::DoneStatus::DS_cont;
+        }, "process_controller_event");
+    }
 
     accept("OpenVRManager::toggle_ar", [this](const Event*) { toggle_ar(); });
 }
@@ -23,7 +23,8 @@ class OpenVRPlugin;
 class OpenVRManager : public rppanda::DirectObject
 {
 public:
-    OpenVRManager(rpcore::RenderPipeline& pipeline);
+    /** @param event_task   Process controller events in its own task. Otherwise, the owner calls process_controller_event(). */
+    OpenVRManager(rpcore::RenderPipeline& pipeline, bool event_task = true);
     virtual ~OpenVRManager();
 
     bool is_available() const;
@@ -39,9 +40,10 @@ public:
     const std::vector<NodePath>& get_controller_nodepaths() const;
     const std::vector<NodePath>& get_tracker_nodepaths() const;
 
+    void process_controller_event();
+
 private:
     void caching_devices();
-    void process_controller_event();
 
     rpcore::RenderPipeline& pipeline_;
     rpplugins::OpenVRPlugin* openvr_plugin_ = nullptr;
@@ -0,0 +1,78 @@
+#include "simulation_loop.hpp"
+
+#include <chrono>
+
+SimulationLoop::SimulationLoop(double rate, int max_steps): dt_(1.0 / rate), max_steps_(max_steps)
+{
+}
+
+void SimulationLoop::add_stage(const std::string& name, const StageFunction& function)
+{
+    stages_.push_back({ name, function });
+}
+
+int SimulationLoop::advance(double frame_dt)
+{
+    const int step_count = begin_frame(frame_dt);
+    run_stages(0, stages_.size(), step_count);
+    end_frame(step_count);
+    return step_count;
+}
+
+void SimulationLoop::step()
+{
+    run_stages(0, stages_.size(), 1);
+    end_frame(1);
+}
+
+int SimulationLoop::begin_frame(double frame_dt)
+{
+    accumulator_ += frame_dt;
+
+    int step_count = 0;
+    while (accumulator_ >= dt_ && step_count < max_steps_)
+    {
+        accumulator_ -= dt_;
+        ++step_count;
+    }
+
+    // drop the rest instead of catching up in later frames.
+    if (accumulator_ >= dt_)
+    {
+        const auto dropped = static_cast<uint64_t>(accumulator_ / dt_);
+        dropped_step_count_ += dropped;
+        accumulator_ -= dropped * dt_;
+    }
+
+    return step_count;
+}
+
+void SimulationLoop::run_stages(size_t first_stage, size_t last_stage, int step_count)
+{
+    for (int i = 0; i < step_count; ++i)
+    {
+        for (size_t k = first_stage; k < last_stage; ++k)
+        {
+            auto& stage = stages_[k];
+            const auto begin_time = std::chrono::steady_clock::now();
+            stage.function(step_count_ + i, dt_);
+            stage.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+            stage.total_ms += stage.ms;
+        }
+    }
+}
+
+void SimulationLoop::end_frame(int step_count)
+{
+    step_count_ += step_count;
+}
+
+void SimulationLoop::reset_statistics()
+{
+    dropped_step_count_ = 0;
+    for (auto&& stage: stages_)
+    {
+        stage.ms = 0;
+        stage.total_ms = 0;
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Simulation stepped at a fixed rate independent of the render rate.
+ *
+ * Elapsed time of frames is accumulated, and each step runs the stages in the order of addition with
+ * the same time step. So the result depends only on the inputs of the steps, and a recorded input
+ * is replayed to the same result.
+ */
+class SimulationLoop
+{
+public:
+    /** @param step   Index of the step. Time of the step is step * dt. */
+    using StageFunction = std::function<void(uint64_t step, double dt)>;
+
+    struct Stage
+    {
+        std::string name;
+        StageFunction function;
+        double ms = 0;                  // time in the last step
+        double total_ms = 0;
+    };
+
+    /** @param max_steps  Steps in a frame are limited, so that slow frames do not accumulate steps. */
+    SimulationLoop(double rate, int max_steps = 4);
+
+    void add_stage(const std::string& name, const StageFunction& function);
+
+    /** Run steps for the elapsed time. @return the number of steps. */
+    int advance(double frame_dt);
+
+    /** Run a step regardless of the elapsed time. */
+    void step();
+
+    /**
+     * Accumulate the elapsed time like advance(), but leave the steps to run_stages() and end_frame(),
+     * so that groups of stages run in separate stages of a frame.
+     * @return  The number of steps of the frame.
+     */
+    int begin_frame(double frame_dt);
+
+    /** Run stages in [@a first_stage, @a last_stage) of each of @a step_count steps in the order of the steps. */
+    void run_stages(size_t first_stage, size_t last_stage, int step_count);
+
+    /** Count @a step_count steps whose stages have run. */
+    void end_frame(int step_count);
+
+    void reset_statistics();
+
+    double get_rate() const;
+    double get_dt() const;
+    uint64_t get_step_count() const;
+
+    /** Fraction of a step in the accumulator to interpolate the last two steps. */
+    double get_alpha() const;
+
+    /** Steps which are dropped by the limit. */
+    uint64_t get_dropped_step_count() const;
+
+    const std::vector<Stage>& get_stages() const;
+
+private:
+    const double dt_;
+    const int max_steps_;
+    double accumulator_ = 0;
+    uint64_t step_count_ = 0;
+    uint64_t dropped_step_count_ = 0;
+
+    std::vector<Stage> stages_;
+};
+
+// ************************************************************************************************
+
+inline double SimulationLoop::get_rate() const
+{
+    return 1.0 / dt_;
+}
+
+inline double SimulationLoop::get_dt() const
+{
+    return dt_;
+}
+
+inline uint64_t SimulationLoop::get_step_count() const
+{
+    return step_count_;
+}
+
+inline double SimulationLoop::get_alpha() const
+{
+    return accumulator_ / dt_;
+}
+
+inline uint64_t SimulationLoop::get_dropped_step_count() const
+{
+    return dropped_step_count_;
+}
+
+inline const std::vector<SimulationLoop::Stage>& SimulationLoop::get_stages() const
+{
+    return stages_;
+}
@@ -0,0 +1,183 @@
+#include "startup_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+void write_json_string(std::ostream& os, const std::string& str)
+{
+    os << '"';
+    for (const char c: str)
+    {
+        switch (c)
+        {
+        case '"':
+            os << "\\\"";
+            break;
+        case '\\':
+            os << "\\\\";
+            break;
+        case '\n':
+            os << "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                os << fmt::format("\\u{:04x}", static_cast<int>(c));
+            else
+                os << c;
+            break;
+        }
+    }
+    os << '"';
+}
+
+}
+
+// ************************************************************************************************
+StartupProfiler::Scope::Scope(StartupProfiler* profiler, const std::string& name): profiler_(profiler)
+{
+    if (profiler_)
+        index_ = profiler_->begin(name);
+}
+
+StartupProfiler::Scope::~Scope()
+{
+    if (profiler_)
+        profiler_->end(index_);
+}
+
+// ************************************************************************************************
+StartupProfiler::StartupProfiler(): origin_(Clock::now())
+{
+}
+
+size_t StartupProfiler::begin(const std::string& name)
+{
+    const auto now = Clock::now();
+    events_.push_back({ name, std::string(), depth_++, now, now });
+    return events_.size() - 1;
+}
+
+void StartupProfiler::end(size_t index)
+{
+    events_[index].end_time = Clock::now();
+    --depth_;
+}
+
+void StartupProfiler::add_event(const std::string& name, const std::string& track, Clock::time_point begin_time, Clock::time_point end_time)
+{
+    events_.push_back({ name, track, 0, begin_time, end_time });
+}
+
+void StartupProfiler::add_event(const std::string& name, const std::string& track, double duration_ms)
+{
+    const auto end_time = Clock::now();
+    add_event(name, track, end_time - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(duration_ms)), end_time);
+}
+
+void StartupProfiler::mark_first_frame()
+{
+    if (has_first_frame_)
+        return;
+
+    first_frame_time_ = Clock::now();
+    has_first_frame_ = true;
+}
+
+double StartupProfiler::get_first_frame_ms() const
+{
+    return has_first_frame_ ? get_elapsed_ms(first_frame_time_) : 0.0;
+}
+
+double StartupProfiler::get_elapsed_ms(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::milli>(time - origin_).count();
+}
+
+void StartupProfiler::log_summary(spdlog::logger& logger) const
+{
+    // main thread first, and the other tracks in order of their start.
+    for (const auto& event: events_)
+    {
+        if (!event.track.empty())
+            continue;
+
+        logger.info("Startup: {:>9.1f} ms {:>9.1f} ms  {}{}",
+            get_elapsed_ms(event.begin_time), std::chrono::duration<double, std::milli>(event.end_time - event.begin_time).count(),
+            std::string(event.depth * 2, ' '), event.name);
+    }
+
+    std::vector<const Event*> track_events;
+    for (const auto& event: events_)
+    {
+        if (!event.track.empty())
+            track_events.push_back(&event);
+    }
+    std::stable_sort(track_events.begin(), track_events.end(), [](const Event* a, const Event* b) { return a->begin_time < b->begin_time; });
+
+    for (const auto* event: track_events)
+    {
+        logger.info("Startup: {:>9.1f} ms {:>9.1f} ms  [{}] {}",
+            get_elapsed_ms(event->begin_time), std::chrono::duration<double, std::milli>(event->end_time - event->begin_time).count(),
+            event->track, event->name);
+    }
+
+    if (has_first_frame_)
+        logger.info("Startup: first frame at {:.1f} ms", get_first_frame_ms());
+}
+
+bool StartupProfiler::write_trace(const Filename& file) const
+{
+    Filename(file).make_dir();
+
+    std::ofstream ofs(file.to_os_specific(), std::ios::trunc);
+    if (!ofs)
+        return false;
+
+    // tracks are threads of one process, and the main thread is 0.
+    std::vector<std::string> tracks = { "main" };
+    const auto get_tid = [&tracks](const std::string& track) {
+        if (track.empty())
+            return size_t(0);
+        const auto iter = std::find(tracks.begin(), tracks.end(), track);
+        if (iter != tracks.end())
+            return static_cast<size_t>(std::distance(tracks.begin(), iter));
+        tracks.push_back(track);
+        return tracks.size() - 1;
+    };
+
+    const auto to_us = [this](Clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time - origin_).count();
+    };
+
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    ofs << fmt::format("{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{{\"name\":\"{}\"}}}}", CRMODULE_ID_STRING);
+
+    for (const auto& event: events_)
+    {
+        ofs << ",\n{\"name\":";
+        write_json_string(ofs, event.name);
+        ofs << fmt::format(",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}",
+            to_us(event.begin_time), to_us(event.end_time) - to_us(event.begin_time), get_tid(event.track));
+    }
+
+    if (has_first_frame_)
+    {
+        ofs << fmt::format(",\n{{\"name\":\"first frame\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.3f},\"pid\":1,\"tid\":0}}",
+            to_us(first_frame_time_));
+    }
+
+    for (size_t k = 0, k_end = tracks.size(); k < k_end; ++k)
+    {
+        ofs << fmt::format(",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":", k);
+        write_json_string(ofs, tracks[k]);
+        ofs << "}}";
+    }
+
+    ofs << "\n]}\n";
+
+    return ofs.good();
+}
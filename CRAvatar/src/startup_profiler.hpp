@@ -0,0 +1,89 @@
+#pragma once
+
+#include <filename.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace spdlog {
+class logger;
+}
+
+/**
+ * Durations of startup phases until the first frame and the initial loads.
+ *
+ * Phases on the main thread are nested by scopes, and work of other threads is added as events with its times.
+ * The summary is logged, and the events are written in the Chrome trace format (chrome://tracing or Perfetto).
+ */
+class StartupProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** Measure the phase until the end of the scope. It does nothing if @a profiler is null. */
+    class Scope
+    {
+    public:
+        Scope(StartupProfiler* profiler, const std::string& name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupProfiler* profiler_;
+        size_t index_ = 0;
+    };
+
+    StartupProfiler();
+
+    size_t begin(const std::string& name);
+    void end(size_t index);
+
+    /**
+     * Add work which is measured outside of scopes.
+     * @param track     Name of the thread in the trace.
+     */
+    void add_event(const std::string& name, const std::string& track, Clock::time_point begin_time, Clock::time_point end_time);
+
+    /** Add work which ends now. */
+    void add_event(const std::string& name, const std::string& track, double duration_ms);
+
+    /** Record the first frame. Only the first call is recorded. */
+    void mark_first_frame();
+    bool has_first_frame() const;
+
+    /** Time from the creation of the profiler (ms). */
+    double get_first_frame_ms() const;
+    double get_elapsed_ms(Clock::time_point time) const;
+
+    void log_summary(spdlog::logger& logger) const;
+
+    /** Write events in the Chrome trace event format. */
+    bool write_trace(const Filename& file) const;
+
+private:
+    struct Event
+    {
+        std::string name;
+        std::string track;          // empty for the main thread
+        int depth;
+        Clock::time_point begin_time;
+        Clock::time_point end_time;
+    };
+
+    Clock::time_point origin_;
+    Clock::time_point first_frame_time_;
+    bool has_first_frame_ = false;
+
+    int depth_ = 0;
+    std::vector<Event> events_;
+};
+
+// ************************************************************************************************
+
+inline bool StartupProfiler::has_first_frame() const
+{
+    return has_first_frame_;
+}
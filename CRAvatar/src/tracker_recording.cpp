@@ -0,0 +1,86 @@
+#include "tracker_recording.hpp"
+
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr char recording_magic[4] = { 'C', 'R', 'T', 'R' };
+constexpr uint32_t recording_version = 1;
+
+struct RecordingHeader
+{
+    char magic[4];
+    uint32_t version;
+    float step_rate;
+    uint32_t sample_count;
+};
+
+// position and quaternion (i, j, k, r)
+using SampleData = float[7];
+
+}
+
+TrackerRecording::TrackerRecording(float step_rate): step_rate_(step_rate)
+{
+}
+
+std::unique_ptr<TrackerRecording> TrackerRecording::read(const Filename& file)
+{
+    std::ifstream ifs(file.to_os_specific(), std::ios::binary | std::ios::ate);
+    if (!ifs)
+        return nullptr;
+
+    const std::streamoff file_size = ifs.tellg();
+    ifs.seekg(0);
+
+    RecordingHeader header;
+    if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, recording_magic, sizeof(header.magic)) != 0 ||
+        header.version != recording_version)
+    {
+        return nullptr;
+    }
+
+    // the count is checked before memory is reserved for it.
+    if (static_cast<uint64_t>(header.sample_count) * sizeof(SampleData) > static_cast<uint64_t>(file_size) - sizeof(header))
+        return nullptr;
+
+    auto recording = std::make_unique<TrackerRecording>(header.step_rate);
+    recording->samples_.reserve(header.sample_count);
+
+    SampleData data;
+    for (uint32_t k = 0; k < header.sample_count && ifs.read(reinterpret_cast<char*>(data), sizeof(data)); ++k)
+        recording->add({ LPoint3f(data[0], data[1], data[2]), LQuaternionf(data[6], data[3], data[4], data[5]) });
+
+    if (recording->size() != header.sample_count)
+        return nullptr;
+
+    return recording;
+}
+
+bool TrackerRecording::write(const Filename& file) const
+{
+    RecordingHeader header = {};
+    std::memcpy(header.magic, recording_magic, sizeof(header.magic));
+    header.version = recording_version;
+    header.step_rate = step_rate_;
+    header.sample_count = static_cast<uint32_t>(samples_.size());
+
+    Filename(file).make_dir();
+
+    std::ofstream ofs(file.to_os_specific(), std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        return false;
+
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& sample: samples_)
+    {
+        const SampleData data = {
+            sample.pos[0], sample.pos[1], sample.pos[2],
+            sample.quat.get_i(), sample.quat.get_j(), sample.quat.get_k(), sample.quat.get_r() };
+        ofs.write(reinterpret_cast<const char*>(data), sizeof(data));
+    }
+
+    return ofs.good();
+}
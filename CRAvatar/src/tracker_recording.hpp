@@ -0,0 +1,56 @@
+#pragma once
+
+#include <filename.h>
+#include <luse.h>
+
+#include <memory>
+#include <vector>
+
+/** Tracker poses of simulation steps which are recorded to replay the same input. */
+class TrackerRecording
+{
+public:
+    struct Sample
+    {
+        LPoint3f pos;
+        LQuaternionf quat;
+    };
+
+    TrackerRecording(float step_rate);
+
+    /** @return null if the file is not a recording. */
+    static std::unique_ptr<TrackerRecording> read(const Filename& file);
+    bool write(const Filename& file) const;
+
+    float get_step_rate() const;
+
+    void add(const Sample& sample);
+    size_t size() const;
+    const Sample& operator[](size_t index) const;
+
+private:
+    float step_rate_;
+    std::vector<Sample> samples_;
+};
+
+// ************************************************************************************************
+
+inline float TrackerRecording::get_step_rate() const
+{
+    return step_rate_;
+}
+
+inline void TrackerRecording::add(const Sample& sample)
+{
+    samples_.push_back(sample);
+}
+
+inline size_t TrackerRecording::size() const
+{
+    return samples_.size();
+}
+
+inline const TrackerRecording::Sample& TrackerRecording::operator[](size_t index) const
+{
+    return samples_[index];
+}
@@ -1,4 +1,5 @@
 set(header_include
+    "${PROJECT_SOURCE_DIR}/include/${CRMODULE_ID}/ground_query.h"
     "${PROJECT_SOURCE_DIR}/include/${CRMODULE_ID}/module.h"
 )
 
@@ -11,7 +12,17 @@ set(module_headers
 
 
 set(source_src
+    "${PROJECT_SOURCE_DIR}/src/arm_chain.cpp"
+    "${PROJECT_SOURCE_DIR}/src/arm_chain.hpp"
+    "${PROJECT_SOURCE_DIR}/src/chain_space.cpp"
+    "${PROJECT_SOURCE_DIR}/src/chain_space.hpp"
+    "${PROJECT_SOURCE_DIR}/src/foot_placement.cpp"
+    "${PROJECT_SOURCE_DIR}/src/foot_placement.hpp"
     "${PROJECT_SOURCE_DIR}/src/module.cpp"
+    "${PROJECT_SOURCE_DIR}/src/pose_cache.cpp"
+    "${PROJECT_SOURCE_DIR}/src/pose_cache.hpp"
+    "${PROJECT_SOURCE_DIR}/src/self_collision.cpp"
+    "${PROJECT_SOURCE_DIR}/src/self_collision.hpp"
 )
 
 # grouping
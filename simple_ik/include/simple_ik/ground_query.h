@@ -0,0 +1,25 @@
+#pragma once
+
+#include <luse.h>
+
+#include <functional>
+#include <vector>
+
+struct GroundRay
+{
+    LPoint3f from;
+    LPoint3f to;
+};
+
+struct GroundHit
+{
+    LPoint3f position;
+    LVector3f normal;
+    bool hit = false;
+};
+
+/**
+ * Resolve all rays against the ground in a single query.
+ * @a hits is resized to the number of @a rays by the caller. Rays and hits are in world space.
+ */
+using GroundQueryFunction = std::function<void(const std::vector<GroundRay>& rays, std::vector<GroundHit>& hits)>;
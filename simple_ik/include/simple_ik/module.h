@@ -3,8 +3,14 @@
 #include <crsf/CRAPI/TDynamicModuleInterface.h>
 #include <render_pipeline/rppanda/showbase/direct_object.hpp>
 
+#include <asyncTask.h>
 #include <nodePath.h>
 
+#include <atomic>
+#include <unordered_map>
+
+#include "simple_ik/ground_query.h"
+
 namespace crsf {
 class TActorObject;
 class TAvatarMemoryObject;
@@ -14,29 +20,147 @@ struct ik_solver_t;
 struct ik_effector_t;
 struct ik_node_t;
 
+class AsyncTaskChain;
+
+class ArmChain;
+class FootPlacement;
+class SelfCollision;
+class PoseCache;
+
 class SimpleIKModule: public crsf::TDynamicModuleInterface, public rppanda::DirectObject
 {
 public:
+    struct Statistics
+    {
+        double solve_ms = 0;                // arm chains including self collision
+        int iterations = 0;                 // largest iterations of arm chains to reach the tolerance
+        size_t arm_count = 0;               // arm chains solved in the frame
+        size_t total_iterations = 0;
+        size_t total_solves = 0;
+
+        size_t cache_exact_hits = 0;        // solving is skipped
+        size_t cache_near_hits = 0;         // solver is warm-started
+        size_t cache_misses = 0;
+        size_t cache_memory = 0;            // bytes of caches of all skeletons
+        double self_collision_ms = 0;
+        size_t self_collision_contacts = 0;
+        double foot_query_ms = 0;           // batched ground query
+        double foot_solve_ms = 0;           // leg chains
+        size_t foot_count = 0;
+        size_t foot_hit_count = 0;
+
+        size_t joint_writes = 0;            // arm joints written in the last solve
+        size_t joint_writes_skipped = 0;    // arm joints which are not changed beyond the epsilon
+        size_t foot_joint_writes = 0;
+        size_t foot_joint_writes_skipped = 0;
+    };
+
+    struct CapsuleProxy
+    {
+        std::string joint_a;
+        std::string joint_b;
+        float radius;
+    };
+
+    /** Solved joints are not written back if their positions move less than this (cm). */
+    static constexpr float joint_write_epsilon = 1e-3f;
+
     SimpleIKModule();
+    ~SimpleIKModule() override;
 
     void OnLoad() override;
     void OnStart() override;
     void OnExit() override;
 
+    /**
+     * Find joints of the actor and keep them, so that SetActor() switches to the actor without searching
+     * the scene graph. It is called by SetActor() if the actor is not prepared.
+     */
+    virtual bool PrepareActor(crsf::TActorObject* actor);
+
+    /** Set the actor which follows the end effector. */
     virtual void SetActor(crsf::TActorObject* actor);
-    virtual void SetAvatarMemoryObject(crsf::TAvatarMemoryObject* amo);
+
+    /**
+     * Solve the arm of the actor to @a target in every frame with the current actor.
+     * Arms of visible actors are solved concurrently on the worker threads.
+     */
+    virtual bool BindActor(crsf::TActorObject* actor, NodePath target);
+    virtual void UnbindActor(crsf::TActorObject* actor);
+
+    /** Set the number of threads including the caller. If it is 0, the number of cores is used. */
+    virtual void SetThreadCount(int thread_count);
+    int GetThreadCount() const;
+
+    /**
+     * Solve joints in the avatar memory.
+     * @param slot_names    Name of the joint of each slot of the memory.
+     */
+    virtual void SetAvatarMemoryObject(crsf::TAvatarMemoryObject* amo, const std::vector<std::string>& slot_names);
+
+    /**
+     * Names of joints which the solvers write (@a driven_joints) and only read (@a observed_joints).
+     * Control joints are needed only for the driven joints.
+     */
+    virtual void GetJointNames(std::vector<std::string>& driven_joints, std::vector<std::string>& observed_joints) const;
+
+    /** Release all data of the actor before it is destroyed. */
+    virtual void RemoveActor(crsf::TActorObject* actor);
 
     void SetEndEffector(NodePath np);
     void SetEndEffector(LVecBase3f* pos);
 
+    /** Set pole target of the elbow. If it is empty, the pole is estimated from the chest frame. */
+    void SetPoleTarget(NodePath np);
+
+    bool IsPoleEnabled() const;
+    void SetPoleEnabled(bool enable);
+
     virtual void SolveIK();
     virtual void StartSolveIKLoop();
     virtual void StopSolveIKLoop();
 
+    /** Place feet of the actor on the ground using the ground query. */
+    virtual bool AddFootPlacement(crsf::TActorObject* actor);
+    virtual void RemoveFootPlacement(crsf::TActorObject* actor);
+    virtual void SolveFootPlacement();
+
+    void SetGroundQuery(const GroundQueryFunction& func);
+
+    /** Set capsules of the body which the arm chain is pushed out of. Prepared actors are bound again. */
+    virtual void SetSelfCollisionProxies(const std::vector<CapsuleProxy>& proxies);
+
+    /** Cache solved poses of the arm chain per skeleton to reuse them for repeated targets. */
+    bool IsPoseCacheEnabled() const;
+    void SetPoseCacheEnabled(bool enable);
+    virtual void ClearPoseCache();
+
+    bool IsSelfCollisionEnabled() const;
+    void SetSelfCollisionEnabled(bool enable);
+
+    const Statistics& GetStatistics() const;
+    void ResetStatistics();
+
 private:
-    ik_solver_t* ik_solver_ = nullptr;
-    ik_effector_t* ik_effector_ = nullptr;
-    std::vector<ik_node_t*> ik_nodes_;
+    struct ActorBinding;
+    struct SolveJob;
+
+    void BindSelfCollision(ActorBinding& binding) const;
+
+    /** Read the target and the pole of the chain on the main thread. @return false if the chain is not solved. */
+    bool PrepareJob(SolveJob& job);
+    void RunJobs();
+    void WriteJob(const SolveJob& job);
+
+    bool GetPolePosition(const ActorBinding& binding, LPoint3f& pole) const;
+
+    // restore bone lengths of the bind pose in the nodes or compute them for a new bind pose or scale.
+    void UpdateDistances(ArmChain& chain, const LVecBase3f& scale);
+
+    // chain of the avatar memory
+    std::unique_ptr<ArmChain> memory_chain_;
+    crsf::TAvatarMemoryObject* memory_object_ = nullptr;
+    PoseCache* memory_pose_cache_ = nullptr;
 
     rppanda::FunctionalTask* update_ik_task_ = nullptr;
 
@@ -44,11 +168,43 @@ private:
     LVecBase3f* end_effector_pos_ = nullptr;
 
     bool use_actor_ = false;
-    std::vector<NodePath> actor_joints_;
+    std::unordered_map<const crsf::TActorObject*, std::unique_ptr<ActorBinding>> actor_bindings_;
+    ActorBinding* binding_ = nullptr;
+
+    // bone lengths keyed by the hash of the bind pose and the scale
+    std::unordered_map<uint64_t, std::vector<double>> bone_length_cache_;
+
+    std::vector<CapsuleProxy> capsule_proxies_;
+    bool self_collision_enabled_ = true;
+    float chain_radius_ = 5.0f;             // cm
+
+    NodePath pole_target_;
+    bool pole_enabled_ = true;
+
+    std::unordered_map<const void*, PoseCache> pose_caches_;
+    bool pose_cache_enabled_ = false;
+
+    // chains are solved by the caller and the threads of the task chain.
+    int thread_count_ = 1;
+    AsyncTaskChain* solve_chain_ = nullptr;
+    std::vector<PT(AsyncTask)> solve_tasks_;    // created with the chain and added in each frame
+    std::vector<SolveJob> jobs_;
+    size_t job_count_ = 0;
+    std::atomic<size_t> next_job_;
+
+    std::unique_ptr<FootPlacement> foot_placement_;
+    GroundQueryFunction ground_query_;
+
+    Statistics stats_;
 };
 
 // ************************************************************************************************
 
+inline int SimpleIKModule::GetThreadCount() const
+{
+    return thread_count_;
+}
+
 inline void SimpleIKModule::SetEndEffector(NodePath np)
 {
     end_effector_ = np;
@@ -58,3 +214,53 @@ inline void SimpleIKModule::SetEndEffector(LVecBase3f* pos)
 {
     end_effector_pos_ = pos;
 }
+
+inline void SimpleIKModule::SetGroundQuery(const GroundQueryFunction& func)
+{
+    ground_query_ = func;
+}
+
+inline void SimpleIKModule::SetPoleTarget(NodePath np)
+{
+    pole_target_ = np;
+}
+
+inline bool SimpleIKModule::IsPoleEnabled() const
+{
+    return pole_enabled_;
+}
+
+inline void SimpleIKModule::SetPoleEnabled(bool enable)
+{
+    pole_enabled_ = enable;
+}
+
+inline bool SimpleIKModule::IsPoseCacheEnabled() const
+{
+    return pose_cache_enabled_;
+}
+
+inline void SimpleIKModule::SetPoseCacheEnabled(bool enable)
+{
+    pose_cache_enabled_ = enable;
+}
+
+inline bool SimpleIKModule::IsSelfCollisionEnabled() const
+{
+    return self_collision_enabled_;
+}
+
+inline void SimpleIKModule::SetSelfCollisionEnabled(bool enable)
+{
+    self_collision_enabled_ = enable;
+}
+
+inline const SimpleIKModule::Statistics& SimpleIKModule::GetStatistics() const
+{
+    return stats_;
+}
+
+inline void SimpleIKModule::ResetStatistics()
+{
+    stats_ = Statistics();
+}
@@ -0,0 +1,91 @@
+#include "arm_chain.hpp"
+
+#include <chrono>
+
+#include <ik/ik.h>
+
+#include "chain_space.hpp"
+#include "self_collision.hpp"
+
+ArmChain::ArmChain(size_t joint_count)
+{
+    /* Create a solver using the FABRIK algorithm */
+    solver_ = ik.solver.create(IK_FABRIK);
+
+    for (size_t k = 0; k < joint_count; ++k)
+    {
+        ik_node_t* node = k == 0 ?
+            solver_->node->create(0) :
+            solver_->node->create_child(nodes_.back(), static_cast<uint32_t>(k));
+        node->user_data = nullptr;
+        nodes_.push_back(node);
+    }
+
+    /* Attach an effector at the end */
+    effector_ = solver_->effector->create();
+    solver_->effector->attach(effector_, nodes_.back());
+
+    //solver_->flags |= IK_ENABLE_TARGET_ROTATIONS;
+    solver_->flags &= ~IK_ENABLE_JOINT_ROTATIONS;
+
+    /* Assign our tree to the solver, rebuild data and calculate solution */
+    ik.solver.set_tree(solver_, nodes_.front());
+    ik.solver.rebuild(solver_);
+}
+
+ArmChain::~ArmChain()
+{
+    ik.solver.destroy(solver_);
+}
+
+void ArmChain::update_distances()
+{
+    ik.solver.update_distances(solver_);
+}
+
+float ArmChain::get_length(size_t base) const
+{
+    float length = 0;
+    for (size_t k = base + 1, k_end = nodes_.size(); k < k_end; ++k)
+        length += static_cast<float>(nodes_[k]->dist_to_parent);
+    return length;
+}
+
+void ArmChain::solve(const LVecBase3f& target, const LPoint3f* pole, SelfCollision* self_collision, float chain_radius, Result& result)
+{
+    effector_->target_position = ik.vec3.vec3(target[0], target[1], target[2]);
+
+    // pre-orient the elbow to the pole, so that FABRIK does not oscillate between bend planes.
+    if (pole)
+    {
+        chain_to_space(nodes_, chain_positions_, chain_rotations_);
+        orient_to_pole(chain_positions_, 1, target, *pole);
+        chain_from_space(nodes_, chain_positions_, chain_rotations_, 2);
+    }
+
+    result.self_collision_contacts = 0;
+    std::chrono::steady_clock::duration collision_duration(0);
+
+    // step the solver one iteration at a time to count iterations until it reaches the tolerance
+    // and to push the chain out of the body between iterations.
+    const int max_iterations = solver_->max_iterations;
+    solver_->max_iterations = 1;
+    int iterations = 0;
+    while (iterations < max_iterations)
+    {
+        if (self_collision)
+        {
+            const auto collision_time = std::chrono::steady_clock::now();
+            result.self_collision_contacts += self_collision->resolve(nodes_, chain_radius);
+            collision_duration += std::chrono::steady_clock::now() - collision_time;
+        }
+
+        ++iterations;
+        if (ik.solver.solve(solver_) == IK_RESULT_CONVERGED)
+            break;
+    }
+    solver_->max_iterations = max_iterations;
+
+    result.iterations = iterations;
+    result.self_collision_ms = std::chrono::duration<double, std::milli>(collision_duration).count();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <luse.h>
+
+#include <vector>
+
+struct ik_solver_t;
+struct ik_effector_t;
+struct ik_node_t;
+
+class SelfCollision;
+
+/**
+ * FABRIK solver of an arm chain.
+ *
+ * Each chain has its own solver data, so chains of actors are solved on worker threads.
+ * The caller reads targets and poles from the scene graph, and solve() touches only the chain.
+ */
+class ArmChain
+{
+public:
+    struct Result
+    {
+        int iterations = 0;
+        size_t self_collision_contacts = 0;
+        double self_collision_ms = 0;
+    };
+
+    explicit ArmChain(size_t joint_count);
+    ~ArmChain();
+
+    ArmChain(const ArmChain&) = delete;
+    ArmChain& operator=(const ArmChain&) = delete;
+
+    const std::vector<ik_node_t*>& get_nodes() const;
+
+    /** Compute bone lengths from the current positions of the nodes. */
+    void update_distances();
+
+    /** Sum of bone lengths after the node @a base. */
+    float get_length(size_t base) const;
+
+    /**
+     * Solve the chain to @a target from the current pose.
+     * @param pole              Pole of the elbow to pre-orient the chain. It is ignored if it is null.
+     * @param self_collision    Capsules which are updated by the caller. It is ignored if it is null.
+     */
+    void solve(const LVecBase3f& target, const LPoint3f* pole, SelfCollision* self_collision, float chain_radius, Result& result);
+
+private:
+    ik_solver_t* solver_ = nullptr;
+    ik_effector_t* effector_ = nullptr;
+    std::vector<ik_node_t*> nodes_;
+
+    std::vector<LPoint3f> chain_positions_;
+    std::vector<LQuaternionf> chain_rotations_;
+};
+
+// ************************************************************************************************
+
+inline const std::vector<ik_node_t*>& ArmChain::get_nodes() const
+{
+    return nodes_;
+}
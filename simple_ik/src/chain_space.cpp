@@ -0,0 +1,69 @@
+#include "chain_space.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <ik/ik.h>
+
+void chain_to_space(const std::vector<ik_node_t*>& nodes,
+    std::vector<LPoint3f>& positions, std::vector<LQuaternionf>& rotations)
+{
+    const size_t count = nodes.size();
+    positions.resize(count);
+    rotations.resize(count);
+    for (size_t k = 0; k < count; ++k)
+    {
+        const auto& pos = nodes[k]->position;
+        const auto& quat = nodes[k]->rotation;
+        const LVecBase3f local(pos.x, pos.y, pos.z);
+        const LQuaternionf rot(quat.w, quat.x, quat.y, quat.z);
+        if (k == 0)
+        {
+            positions[k] = local;
+            rotations[k] = rot;
+        }
+        else
+        {
+            positions[k] = positions[k - 1] + rotations[k - 1].xform(local);
+            rotations[k] = rot * rotations[k - 1];
+        }
+    }
+}
+
+void chain_from_space(const std::vector<ik_node_t*>& nodes,
+    const std::vector<LPoint3f>& positions, const std::vector<LQuaternionf>& rotations, size_t first)
+{
+    for (size_t k = (std::max)(first, size_t(1)), k_end = nodes.size(); k < k_end; ++k)
+    {
+        LQuaternionf inv_rot;
+        inv_rot.invert_from(rotations[k - 1]);
+        const LVecBase3f local = inv_rot.xform(positions[k] - positions[k - 1]);
+        nodes[k]->position = ik.vec3.vec3(local[0], local[1], local[2]);
+    }
+}
+
+void orient_to_pole(std::vector<LPoint3f>& positions, size_t base, const LPoint3f& target, const LPoint3f& pole)
+{
+    if (base + 2 >= positions.size())
+        return;
+
+    const LPoint3f& origin = positions[base];
+    LVector3f axis = target - origin;
+    if (!axis.normalize())
+        return;
+
+    // project the next joint and the pole onto the plane perpendicular to the axis
+    LVector3f joint_dir = positions[base + 1] - origin;
+    joint_dir -= axis * joint_dir.dot(axis);
+    LVector3f pole_dir = pole - origin;
+    pole_dir -= axis * pole_dir.dot(axis);
+    if (!joint_dir.normalize() || !pole_dir.normalize())
+        return;
+
+    const float angle = std::atan2(joint_dir.cross(pole_dir).dot(axis), joint_dir.dot(pole_dir));
+
+    LQuaternionf rot;
+    rot.set_from_axis_angle_rad(angle, axis);
+    for (size_t k = base + 1, k_end = positions.size(); k < k_end; ++k)
+        positions[k] = origin + rot.xform(positions[k] - origin);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <luse.h>
+
+#include <vector>
+
+struct ik_node_t;
+
+/**
+ * Convert local transforms of the chain nodes to the solving space (parent of the root node).
+ */
+void chain_to_space(const std::vector<ik_node_t*>& nodes,
+    std::vector<LPoint3f>& positions, std::vector<LQuaternionf>& rotations);
+
+/**
+ * Write positions in the solving space back to local positions of the nodes from @a first.
+ * Rotations are kept.
+ */
+void chain_from_space(const std::vector<ik_node_t*>& nodes,
+    const std::vector<LPoint3f>& positions, const std::vector<LQuaternionf>& rotations, size_t first);
+
+/**
+ * Rotate the joints after @a base rigidly about the axis from @a base to @a target,
+ * so that the next joint of @a base lies on the side of @a pole.
+ */
+void orient_to_pole(std::vector<LPoint3f>& positions, size_t base, const LPoint3f& target, const LPoint3f& pole);
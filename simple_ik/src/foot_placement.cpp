@@ -0,0 +1,234 @@
+#include "foot_placement.hpp"
+
+#include <chrono>
+
+#include <ik/ik.h>
+
+#include <transformState.h>
+
+#include <crsf/CRModel/TActorObject.h>
+
+namespace {
+
+const std::vector<std::string> left_leg_joint_names = { "l_hip", "l_knee", "l_talocrural" };
+const std::vector<std::string> right_leg_joint_names = { "r_hip", "r_knee", "r_talocrural" };
+
+bool write_joint_pos(NodePath& np, const LVecBase3f& pos)
+{
+    if ((np.get_pos() - pos).length_squared() <= SimpleIKModule::joint_write_epsilon * SimpleIKModule::joint_write_epsilon)
+        return false;
+
+    np.set_pos(pos);
+    return true;
+}
+
+}
+
+void FootPlacement::get_joint_names(std::vector<std::string>& names)
+{
+    names.insert(names.end(), left_leg_joint_names.begin(), left_leg_joint_names.end());
+    names.insert(names.end(), right_leg_joint_names.begin(), right_leg_joint_names.end());
+}
+
+FootPlacement::~FootPlacement()
+{
+    clear();
+}
+
+bool FootPlacement::add_actor(crsf::TActorObject* actor)
+{
+    if (!actor)
+        return false;
+
+    for (const auto& leg: legs_)
+    {
+        if (leg.actor == actor)
+            return true;
+    }
+
+    const bool left = add_leg(actor, left_leg_joint_names);
+    const bool right = add_leg(actor, right_leg_joint_names);
+    return left || right;
+}
+
+void FootPlacement::remove_actor(crsf::TActorObject* actor)
+{
+    for (auto iter = legs_.begin(); iter != legs_.end();)
+    {
+        if (iter->actor != actor)
+        {
+            ++iter;
+            continue;
+        }
+
+        for (size_t k = 0, k_end = iter->joints.size(); k < k_end; ++k)
+            iter->joints[k].set_pos(iter->bind_positions[k]);
+
+        ik.solver.destroy(iter->solver);
+        iter = legs_.erase(iter);
+    }
+}
+
+void FootPlacement::clear()
+{
+    for (auto&& leg: legs_)
+        ik.solver.destroy(leg.solver);
+    legs_.clear();
+}
+
+bool FootPlacement::add_leg(crsf::TActorObject* actor, const std::vector<std::string>& joint_names)
+{
+    NodePath actor_np = actor->GetNodePath();
+
+    Leg leg;
+    leg.actor = actor;
+    for (const auto& name: joint_names)
+    {
+        NodePath np = actor_np.find("**/" + name);
+        if (!np)
+            return false;
+        leg.joints.push_back(np);
+        leg.bind_positions.push_back(np.get_pos());
+        leg.bind_rotations.push_back(np.get_quat());
+    }
+
+    leg.solver = ik.solver.create(IK_FABRIK);
+    leg.solver->flags &= ~IK_ENABLE_JOINT_ROTATIONS;
+
+    for (size_t k = 0, k_end = leg.joints.size(); k < k_end; ++k)
+    {
+        const auto& pos = leg.bind_positions[k];
+        const auto& quat = leg.bind_rotations[k];
+        ik_node_t* node = k == 0 ?
+            leg.solver->node->create(0) :
+            leg.solver->node->create_child(leg.nodes.back(), static_cast<uint32_t>(k));
+        node->position = ik.vec3.vec3(pos[0], pos[1], pos[2]);
+        node->rotation = ik.quat.quat(quat.get_i(), quat.get_j(), quat.get_k(), quat.get_r());
+        node->user_data = nullptr;
+        leg.nodes.push_back(node);
+    }
+
+    leg.effector = leg.solver->effector->create();
+    leg.solver->effector->attach(leg.effector, leg.nodes.back());
+
+    ik.solver.set_tree(leg.solver, leg.nodes.front());
+    ik.solver.rebuild(leg.solver);
+
+    const NodePath world = actor_np.get_top();
+    leg.length = (leg.joints.front().get_pos(world) - leg.joints.back().get_pos(world)).length();
+
+    legs_.push_back(std::move(leg));
+
+    return true;
+}
+
+void FootPlacement::solve(const GroundQueryFunction& ground_query, SimpleIKModule::Statistics& stats)
+{
+    stats.foot_count = legs_.size();
+    stats.foot_hit_count = 0;
+    stats.foot_query_ms = 0;
+    stats.foot_solve_ms = 0;
+    stats.foot_joint_writes = 0;
+    stats.foot_joint_writes_skipped = 0;
+
+    if (legs_.empty() || !ground_query)
+        return;
+
+    const auto begin_time = std::chrono::steady_clock::now();
+
+    // legs of hidden actors are kept, so switching actors does not find their joints again.
+    active_legs_.clear();
+    for (size_t k = 0, k_end = legs_.size(); k < k_end; ++k)
+    {
+        if (!legs_[k].actor->GetNodePath().is_hidden())
+            active_legs_.push_back(k);
+    }
+    stats.foot_count = active_legs_.size();
+
+    // collect rays of all feet from the ankles in bind pose.
+    rays_.resize(active_legs_.size());
+    hits_.resize(active_legs_.size());
+    ankle_heights_.resize(active_legs_.size());
+    for (size_t k = 0, k_end = active_legs_.size(); k < k_end; ++k)
+    {
+        const auto& leg = legs_[active_legs_[k]];
+
+        const NodePath actor_np = leg.actor->GetNodePath();
+        const NodePath world = actor_np.get_top();
+        const LPoint3f ankle = world.get_relative_point(leg.joints.front().get_parent(), get_bind_ankle_pos(leg));
+        const LVector3f reach(0, 0, leg.length * 0.5f);
+
+        ankle_heights_[k] = ankle[2] - actor_np.get_z(world);
+        rays_[k].from = ankle + reach;
+        rays_[k].to = ankle - reach;
+        hits_[k].hit = false;
+    }
+
+    ground_query(rays_, hits_);
+
+    const auto query_time = std::chrono::steady_clock::now();
+
+    for (size_t k = 0, k_end = active_legs_.size(); k < k_end; ++k)
+    {
+        auto& leg = legs_[active_legs_[k]];
+
+        // joints are written once per frame and only if they are changed.
+        const auto& hit = hits_[k];
+        if (!hit.hit)
+        {
+            for (size_t i = 0, i_end = leg.joints.size(); i < i_end; ++i)
+                count_write(write_joint_pos(leg.joints[i], leg.bind_positions[i]), stats);
+            continue;
+        }
+
+        ++stats.foot_hit_count;
+
+        const NodePath space = leg.joints.front().get_parent();
+        const LPoint3f target = space.get_relative_point(leg.actor->GetNodePath().get_top(),
+            hit.position + LVector3f(0, 0, ankle_heights_[k]));
+
+        for (size_t i = 0, i_end = leg.nodes.size(); i < i_end; ++i)
+        {
+            const auto& pos = leg.bind_positions[i];
+            const auto& quat = leg.bind_rotations[i];
+            leg.nodes[i]->position = ik.vec3.vec3(pos[0], pos[1], pos[2]);
+            leg.nodes[i]->rotation = ik.quat.quat(quat.get_i(), quat.get_j(), quat.get_k(), quat.get_r());
+        }
+        leg.effector->target_position = ik.vec3.vec3(target[0], target[1], target[2]);
+
+        ik.solver.solve(leg.solver);
+
+        // base node is not affected by the solver
+        count_write(write_joint_pos(leg.joints.front(), leg.bind_positions.front()), stats);
+        for (size_t i = 1, i_end = leg.nodes.size(); i < i_end; ++i)
+        {
+            const auto& pos = leg.nodes[i]->position;
+            count_write(write_joint_pos(leg.joints[i], LVecBase3f(pos.x, pos.y, pos.z)), stats);
+        }
+    }
+
+    const auto end_time = std::chrono::steady_clock::now();
+
+    stats.foot_query_ms = std::chrono::duration<double, std::milli>(query_time - begin_time).count();
+    stats.foot_solve_ms = std::chrono::duration<double, std::milli>(end_time - query_time).count();
+}
+
+LPoint3f FootPlacement::get_bind_ankle_pos(const Leg& leg)
+{
+    // the leg is written with positions only, so rotations and scales of the joints are kept.
+    LPoint3f pos = leg.bind_positions.back();
+    for (size_t i = leg.joints.size() - 1; i-- > 0;)
+    {
+        const NodePath& joint = leg.joints[i];
+        pos = TransformState::make_pos_quat_scale(leg.bind_positions[i], joint.get_quat(), joint.get_scale())->get_mat().xform_point(pos);
+    }
+    return pos;
+}
+
+void FootPlacement::count_write(bool written, SimpleIKModule::Statistics& stats)
+{
+    if (written)
+        ++stats.foot_joint_writes;
+    else
+        ++stats.foot_joint_writes_skipped;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <nodePath.h>
+
+#include "simple_ik/module.h"
+
+class FootPlacement
+{
+public:
+    /** Append names of leg joints which are written by the solver. */
+    static void get_joint_names(std::vector<std::string>& names);
+
+    ~FootPlacement();
+
+    bool add_actor(crsf::TActorObject* actor);
+    void remove_actor(crsf::TActorObject* actor);
+    void clear();
+
+    /** Cast rays of all feet in one ground query and solve leg chains to the contact points. */
+    void solve(const GroundQueryFunction& ground_query, SimpleIKModule::Statistics& stats);
+
+private:
+    struct Leg
+    {
+        crsf::TActorObject* actor;
+
+        ik_solver_t* solver;
+        ik_effector_t* effector;
+        std::vector<ik_node_t*> nodes;
+
+        std::vector<NodePath> joints;               // hip, knee, ankle
+        std::vector<LVecBase3f> bind_positions;
+        std::vector<LQuaternionf> bind_rotations;
+        float length;
+    };
+
+    bool add_leg(crsf::TActorObject* actor, const std::vector<std::string>& joint_names);
+
+    /** Ankle position in the parent of the hip when the leg is in bind pose. */
+    static LPoint3f get_bind_ankle_pos(const Leg& leg);
+
+    static void count_write(bool written, SimpleIKModule::Statistics& stats);
+
+    std::vector<Leg> legs_;
+
+    // reused in every frame
+    std::vector<size_t> active_legs_;
+    std::vector<GroundRay> rays_;
+    std::vector<GroundHit> hits_;
+    std::vector<float> ankle_heights_;
+};
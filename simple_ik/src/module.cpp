@@ -1,19 +1,90 @@
 #include "simple_ik/module.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <thread>
+
 #include <spdlog/spdlog.h>
 
 #include <ik/ik.h>
 
+#include <asyncTaskManager.h>
+#include <genericAsyncTask.h>
+
 #include <crsf/CRModel/TActorObject.h>
 #include <crsf/CoexistenceInterface/TAvatarMemoryObject.h>
 
+#include "arm_chain.hpp"
+#include "foot_placement.hpp"
+#include "pose_cache.hpp"
+#include "self_collision.hpp"
+
 CRSEEDLIB_MODULE_CREATOR(SimpleIKModule)
 
 // ************************************************************************************************
-SimpleIKModule::SimpleIKModule(): crsf::TDynamicModuleInterface(CRMODULE_ID_STRING)
+namespace {
+
+// H-Anim joints from the clavicle to the wrist
+const char* const arm_joint_names[] = { "r_acromioclavicular", "r_shoulder", "r_elbow", "r_wrist" };
+
+// joints of the chest frame for the heuristic pole
+const char* const chest_joint_names[] = { "vl1", "vc7", "l_shoulder", "r_shoulder" };
+
+// FNV-1a over bits of the value
+template <class T>
+void hash_value(uint64_t& hash, const T& value)
+{
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (const auto b: bytes)
+    {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+}
+
+}
+
+// ************************************************************************************************
+struct SimpleIKModule::ActorBinding
+{
+    NodePath actor_np;
+    std::vector<NodePath> joints;                   // arm chain
+    std::vector<NodePath> chest_joints;             // empty if the chest frame is not found
+    std::unique_ptr<SelfCollision> self_collision;  // null if no proxy is found
+
+    std::unique_ptr<ArmChain> chain;
+    PoseCache* pose_cache = nullptr;
+    NodePath target;                                // empty if the actor is not bound
+};
+
+struct SimpleIKModule::SolveJob
+{
+    ArmChain* chain;
+    ActorBinding* binding;                          // null for the avatar memory
+
+    // inputs which are read from the scene graph on the main thread
+    LVecBase3f target;
+    bool has_pole;
+    LPoint3f pole;
+    SelfCollision* self_collision;
+    PoseCache* pose_cache;
+    PoseCache::Key cache_key;
+    PoseCache::HitType cache_hit;
+
+    ArmChain::Result result;
+};
+
+// ************************************************************************************************
+SimpleIKModule::SimpleIKModule(): crsf::TDynamicModuleInterface(CRMODULE_ID_STRING), next_job_(0)
 {
 }
 
+SimpleIKModule::~SimpleIKModule() = default;
+
 void SimpleIKModule::OnLoad()
 {
     if (ik.init() != IK_OK)
@@ -22,29 +93,11 @@ void SimpleIKModule::OnLoad()
         return;
     }
 
-    /* Create a solver using the FABRIK algorithm */
-    ik_solver_ = ik.solver.create(IK_FABRIK);
-
-    /* Create a simple 3-bone structure */
-    ik_nodes_.push_back(ik_solver_->node->create(0));
-    ik_nodes_.back()->user_data = nullptr;
-    ik_nodes_.push_back(ik_solver_->node->create_child(ik_nodes_.back(), 1));
-    ik_nodes_.back()->user_data = nullptr;
-    ik_nodes_.push_back(ik_solver_->node->create_child(ik_nodes_.back(), 2));
-    ik_nodes_.back()->user_data = nullptr;
-    ik_nodes_.push_back(ik_solver_->node->create_child(ik_nodes_.back(), 3));
-    ik_nodes_.back()->user_data = nullptr;
-
-    /* Attach an effector at the end */
-    ik_effector_ = ik_solver_->effector->create();
-    ik_solver_->effector->attach(ik_effector_, ik_nodes_.back());
+    memory_chain_ = std::make_unique<ArmChain>(sizeof(arm_joint_names) / sizeof(arm_joint_names[0]));
 
-    //ik_solver_->flags |= IK_ENABLE_TARGET_ROTATIONS;
-    ik_solver_->flags &= ~IK_ENABLE_JOINT_ROTATIONS;
+    capsule_proxies_ = SelfCollision::get_default_proxies();
 
-    /* Assign our tree to the solver, rebuild data and calculate solution */
-    ik.solver.set_tree(ik_solver_, ik_nodes_.front());
-    ik.solver.rebuild(ik_solver_);
+    foot_placement_ = std::make_unique<FootPlacement>();
 }
 
 void SimpleIKModule::OnStart()
@@ -57,116 +110,497 @@ void SimpleIKModule::OnExit()
         update_ik_task_->remove();
     update_ik_task_ = nullptr;
 
+    solve_tasks_.clear();
+    if (solve_chain_)
+        AsyncTaskManager::get_global_ptr()->remove_task_chain(solve_chain_->get_name());
+    solve_chain_ = nullptr;
+
+    foot_placement_.reset();
+    binding_ = nullptr;
+    actor_bindings_.clear();
+    memory_chain_.reset();
+
     ik.deinit();
 }
 
+bool SimpleIKModule::PrepareActor(crsf::TActorObject* actor)
+{
+    if (!actor || !memory_chain_)
+        return false;
+
+    auto binding = std::make_unique<ActorBinding>();
+    binding->actor_np = actor->GetNodePath();
+
+    for (const auto& name: arm_joint_names)
+    {
+        NodePath np = binding->actor_np.find(std::string("**/") + name);
+        if (!np)
+            return false;
+        binding->joints.push_back(np);
+    }
+
+    // chest frame for the heuristic pole
+    for (const auto& name: chest_joint_names)
+    {
+        NodePath joint = binding->actor_np.find(std::string("**/") + name);
+        if (!joint)
+        {
+            binding->chest_joints.clear();
+            break;
+        }
+        binding->chest_joints.push_back(joint);
+    }
+
+    BindSelfCollision(*binding);
+
+    // each actor has its own solver, so the chain keeps the last solution of the actor.
+    binding->chain = std::make_unique<ArmChain>(binding->joints.size());
+    const auto& nodes = binding->chain->get_nodes();
+    for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
+    {
+        const auto pos = binding->joints[k].get_pos();
+        const auto quat = binding->joints[k].get_quat();
+        nodes[k]->position = ik.vec3.vec3(pos[0], pos[1], pos[2]);
+        nodes[k]->rotation = ik.quat.quat(quat.get_i(), quat.get_j(), quat.get_k(), quat.get_r());
+    }
+    UpdateDistances(*binding->chain, binding->actor_np.get_scale());
+
+    binding->pose_cache = &pose_caches_[actor];
+
+    auto& slot = actor_bindings_[actor];
+    if (slot)
+    {
+        binding->target = slot->target;
+        if (binding_ == slot.get())
+            binding_ = binding.get();
+    }
+    slot = std::move(binding);
+
+    return true;
+}
+
 void SimpleIKModule::SetActor(crsf::TActorObject* actor)
 {
     if (!actor)
         return;
 
-    NodePath np = actor->GetNodePath().find("**/r_acromioclavicular");
-    if (!np)
-        return;
+    auto iter = actor_bindings_.find(actor);
+    if (iter == actor_bindings_.end())
+    {
+        if (!PrepareActor(actor))
+            return;
+        iter = actor_bindings_.find(actor);
+    }
 
-    actor_joints_.clear();
-    actor_joints_.reserve(ik_nodes_.size() * 2);     // prevent re-allocation
+    binding_ = iter->second.get();
+    use_actor_ = true;
+}
 
-    for (auto&& node : ik_nodes_)
-    {
-        actor_joints_.push_back(np);
+bool SimpleIKModule::BindActor(crsf::TActorObject* actor, NodePath target)
+{
+    if (!actor || !target)
+        return false;
 
-        const auto pos = np.get_pos();
-        const auto quat = np.get_quat();
-        node->position = ik.vec3.vec3(pos[0], pos[1], pos[2]);
-        node->rotation = ik.quat.quat(quat.get_i(), quat.get_j(), quat.get_k(), quat.get_r());
-        node->user_data = &actor_joints_.back();
-        np = np.get_child(0);
+    auto iter = actor_bindings_.find(actor);
+    if (iter == actor_bindings_.end())
+    {
+        if (!PrepareActor(actor))
+            return false;
+        iter = actor_bindings_.find(actor);
     }
 
-    ik.solver.update_distances(ik_solver_);
+    iter->second->target = target;
+    return true;
+}
 
-    use_actor_ = true;
+void SimpleIKModule::UnbindActor(crsf::TActorObject* actor)
+{
+    auto iter = actor_bindings_.find(actor);
+    if (iter != actor_bindings_.end())
+        iter->second->target.clear();
 }
 
-void SimpleIKModule::SetAvatarMemoryObject(crsf::TAvatarMemoryObject* amo)
+void SimpleIKModule::SetThreadCount(int thread_count)
 {
-    if (!amo)
+    if (thread_count <= 0)
+        thread_count = (std::max)(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    if (thread_count == thread_count_ && (solve_chain_ || thread_count == 1))
         return;
 
-    const auto& am = amo->GetAvatarMemory();
+    AsyncTaskManager* manager = AsyncTaskManager::get_global_ptr();
+    solve_tasks_.clear();
+    if (solve_chain_)
+        manager->remove_task_chain(solve_chain_->get_name());
+    solve_chain_ = nullptr;
+
+    // the caller solves chains too
+    thread_count_ = thread_count;
+    if (thread_count_ > 1)
+    {
+        solve_chain_ = manager->make_task_chain("SimpleIK-" + std::to_string(thread_count_));
+        solve_chain_->set_num_threads(thread_count_ - 1);
+        solve_chain_->set_thread_priority(TP_high);
+
+        // tasks are added again in each frame.
+        for (int k = 1; k < thread_count_; ++k)
+        {
+            PT(AsyncTask) task = new GenericAsyncTask("SimpleIKModule::RunJobs", [](GenericAsyncTask*, void* user_data) {
+                static_cast<SimpleIKModule*>(user_data)->RunJobs();
+                return AsyncTask::DS_done;
+            }, this);
+            task->set_task_chain(solve_chain_->get_name());
+            solve_tasks_.push_back(task);
+        }
+    }
+}
 
-    if (am.size() < 50)
+void SimpleIKModule::SetAvatarMemoryObject(crsf::TAvatarMemoryObject* amo, const std::vector<std::string>& slot_names)
+{
+    if (!amo || !memory_chain_)
         return;
 
-    size_t index = 45;                  // r_acromioclavicular
-    for (auto&& node : ik_nodes_)
+    const auto& am = amo->GetAvatarMemory();
+
+    // slots are checked once, so the solver reads and writes the memory in place.
+    std::vector<size_t> slots;
+    for (const auto& name: arm_joint_names)
+    {
+        const auto iter = std::find(slot_names.begin(), slot_names.end(), name);
+        const size_t slot = static_cast<size_t>(std::distance(slot_names.begin(), iter));
+        if (iter == slot_names.end() || slot >= am.size())
+        {
+            m_logger->error("Avatar memory has no slot of joint {}", name);
+            return;
+        }
+        slots.push_back(slot);
+    }
+
+    const auto& nodes = memory_chain_->get_nodes();
+    for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
     {
-        const auto& pose = am[index];
+        ik_node_t* node = nodes[k];
+        const auto& pose = am[slots[k]];
 
         const auto pos = pose.GetPosition();
         const auto quat = pose.GetQuaternion();
         node->position = ik.vec3.vec3(pos[0], pos[1], pos[2]);
         node->rotation = ik.quat.quat(quat.get_i(), quat.get_j(), quat.get_k(), quat.get_r());
         node->user_data = amo;
-        node->guid = index;
-
-        ++index;
+        node->guid = static_cast<uint32_t>(slots[k]);
     }
 
-    ik.solver.update_distances(ik_solver_);
+    UpdateDistances(*memory_chain_, LVecBase3f(1.0f));
+
+    memory_object_ = amo;
+    memory_pose_cache_ = &pose_caches_[amo];
 
     use_actor_ = false;
 }
 
+void SimpleIKModule::GetJointNames(std::vector<std::string>& driven_joints, std::vector<std::string>& observed_joints) const
+{
+    driven_joints.insert(driven_joints.end(), std::begin(arm_joint_names), std::end(arm_joint_names));
+    FootPlacement::get_joint_names(driven_joints);
+
+    observed_joints.insert(observed_joints.end(), std::begin(chest_joint_names), std::end(chest_joint_names));
+    for (const auto& proxy: capsule_proxies_)
+    {
+        observed_joints.push_back(proxy.joint_a);
+        observed_joints.push_back(proxy.joint_b);
+    }
+}
+
+void SimpleIKModule::RemoveActor(crsf::TActorObject* actor)
+{
+    if (!actor)
+        return;
+
+    RemoveFootPlacement(actor);
+
+    auto binding = actor_bindings_.find(actor);
+    if (binding != actor_bindings_.end())
+    {
+        if (binding_ == binding->second.get())
+            binding_ = nullptr;
+        actor_bindings_.erase(binding);
+    }
+
+    // pose caches are keyed by the address, which a new actor may reuse.
+    pose_caches_.erase(actor);
+}
+
 void SimpleIKModule::SolveIK()
 {
-    if (!ik_solver_)
+    stats_.solve_ms = 0;
+    stats_.iterations = 0;
+    stats_.arm_count = 0;
+    stats_.self_collision_ms = 0;
+    stats_.self_collision_contacts = 0;
+    stats_.joint_writes = 0;
+    stats_.joint_writes_skipped = 0;
+
+    if (!memory_chain_)
+        return;
+
+    const auto begin_time = std::chrono::steady_clock::now();
+
+    // collect chains of the current actor (or the avatar memory) and bound actors.
+    job_count_ = 0;
+    const auto add_job = [this](ArmChain* chain, ActorBinding* binding) {
+        if (jobs_.size() <= job_count_)
+            jobs_.resize(job_count_ + 1);
+        SolveJob& job = jobs_[job_count_];
+        job.chain = chain;
+        job.binding = binding;
+        if (PrepareJob(job))
+            ++job_count_;
+    };
+
+    if (!use_actor_ && memory_object_)
+        add_job(memory_chain_.get(), nullptr);
+
+    for (auto&& binding: actor_bindings_)
+    {
+        ActorBinding* actor_binding = binding.second.get();
+        if ((use_actor_ && actor_binding == binding_) || actor_binding->target)
+            add_job(actor_binding->chain.get(), actor_binding);
+    }
+
+    if (job_count_ == 0)
         return;
 
-    LVecBase3f pos;
-    if (end_effector_)
+    // solvers of chains are independent, so chains are solved in parallel.
+    next_job_ = 0;
+
+    const size_t task_count = (std::min)(solve_tasks_.size(), job_count_ - 1);
+    AsyncTaskManager* manager = AsyncTaskManager::get_global_ptr();
+    for (size_t k = 0; k < task_count; ++k)
+        manager->add(solve_tasks_[k]);
+
+    RunJobs();
+
+    for (size_t k = 0; k < task_count; ++k)
+        solve_tasks_[k]->wait();
+
+    for (size_t k = 0; k < job_count_; ++k)
+        WriteJob(jobs_[k]);
+
+    stats_.arm_count = job_count_;
+
+    stats_.cache_memory = 0;
+    for (const auto& skeleton_cache: pose_caches_)
+        stats_.cache_memory += skeleton_cache.second.get_memory_usage();
+
+    stats_.solve_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+}
+
+bool SimpleIKModule::PrepareJob(SolveJob& job)
+{
+    ActorBinding* binding = job.binding;
+    NodePath space;
+    if (binding)
     {
-        pos = end_effector_.get_pos(actor_joints_.front().get_parent());
+        if (binding->actor_np.is_hidden())
+            return false;
+        space = binding->joints.front().get_parent();
+    }
+
+    if (binding && binding->target)
+    {
+        job.target = binding->target.get_pos(space);
+    }
+    else if (end_effector_)
+    {
+        job.target = end_effector_.get_pos(space);
     }
     else if (end_effector_pos_)
     {
-        pos = *end_effector_pos_;
+        job.target = *end_effector_pos_;
     }
     else
     {
         m_logger->error("No end effector");
-        return;
+        return false;
     }
 
-    ik_effector_->target_position = ik.vec3.vec3(pos[0], pos[1], pos[2]);
+    job.pose_cache = nullptr;
+    job.cache_hit = PoseCache::HitType::miss;
+    if (pose_cache_enabled_)
+        job.pose_cache = binding ? binding->pose_cache : memory_pose_cache_;
 
-    ik.solver.solve(ik_solver_);
+    if (job.pose_cache)
+    {
+        LVecBase3f root_pos(0);
+        LQuaternionf root_quat = LQuaternionf::ident_quat();
+        if (binding)
+        {
+            root_pos = space.get_pos(binding->actor_np);
+            root_quat = space.get_quat(binding->actor_np);
+        }
+
+        job.cache_key = job.pose_cache->make_key(job.target, root_pos, root_quat);
+        job.cache_hit = job.pose_cache->find(job.cache_key, job.chain->get_nodes());
+
+        switch (job.cache_hit)
+        {
+        case PoseCache::HitType::exact_hit:
+            ++stats_.cache_exact_hits;
+            break;
+        case PoseCache::HitType::near_hit:
+            ++stats_.cache_near_hits;
+            break;
+        default:
+            ++stats_.cache_misses;
+            break;
+        }
+    }
+
+    job.has_pole = false;
+    job.self_collision = nullptr;
+    if (job.cache_hit == PoseCache::HitType::exact_hit || !binding)
+        return true;
+
+    // warm-started pose is already in the plane of the cached solution.
+    if (job.cache_hit == PoseCache::HitType::miss && pole_enabled_)
+        job.has_pole = GetPolePosition(*binding, job.pole);
 
-    if (use_actor_)
+    // capsules read joints of the scene graph, so they are updated before the worker threads.
+    if (self_collision_enabled_ && binding->self_collision)
     {
-        ik.solver.iterate_affected_nodes(ik_solver_, [](ik_node_t* ikNode) {
-            if (!ikNode->user_data)
-                return;
+        const auto collision_time = std::chrono::steady_clock::now();
+        binding->self_collision->update_capsules();
+        stats_.self_collision_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - collision_time).count();
+        job.self_collision = binding->self_collision.get();
+    }
 
-            NodePath* node = (NodePath*)ikNode->user_data;
-            node->set_pos(ikNode->position.x, ikNode->position.y, ikNode->position.z);
-        });
+    return true;
+}
+
+void SimpleIKModule::RunJobs()
+{
+    for (size_t k = next_job_++; k < job_count_; k = next_job_++)
+    {
+        SolveJob& job = jobs_[k];
+        job.result = ArmChain::Result();
+        if (job.cache_hit != PoseCache::HitType::exact_hit)
+            job.chain->solve(job.target, job.has_pole ? &job.pole : nullptr, job.self_collision, chain_radius_, job.result);
     }
-    else
+}
+
+void SimpleIKModule::WriteJob(const SolveJob& job)
+{
+    const auto& nodes = job.chain->get_nodes();
+
+    if (job.cache_hit != PoseCache::HitType::exact_hit)
     {
-        ik.solver.iterate_affected_nodes(ik_solver_, [](ik_node_t* ikNode) {
-            if (!ikNode->user_data)
-                return;
+        if (job.pose_cache)
+            job.pose_cache->insert(job.cache_key, nodes);
+
+        stats_.iterations = (std::max)(stats_.iterations, job.result.iterations);
+        stats_.total_iterations += job.result.iterations;
+        ++stats_.total_solves;
+        stats_.self_collision_ms += job.result.self_collision_ms;
+        stats_.self_collision_contacts += job.result.self_collision_contacts;
+    }
 
-            crsf::TAvatarMemoryObject* amo = (crsf::TAvatarMemoryObject*)ikNode->user_data;
-            auto pose = amo->GetAvatarMemory(ikNode->guid);
-            pose.SetPosition(LVecBase3f(ikNode->position.x, ikNode->position.y, ikNode->position.z));
-            amo->SetAvatarMemory(ikNode->guid, pose);
-        });
+    // write only changed joints, because each write invalidates cached transforms of the subtree.
+    const float epsilon_sq = joint_write_epsilon * joint_write_epsilon;
+    for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
+    {
+        const ik_node_t* ik_node = nodes[k];
+        const LVecBase3f solved(ik_node->position.x, ik_node->position.y, ik_node->position.z);
+        if (job.binding)
+        {
+            NodePath& node = job.binding->joints[k];
+            if ((node.get_pos() - solved).length_squared() <= epsilon_sq)
+            {
+                ++stats_.joint_writes_skipped;
+                continue;
+            }
+            node.set_pos(solved);
+        }
+        else
+        {
+            crsf::TAvatarMemoryObject* amo = (crsf::TAvatarMemoryObject*)ik_node->user_data;
+            auto pose = amo->GetAvatarMemory(ik_node->guid);
+            if ((LVecBase3f(pose.GetPosition()) - solved).length_squared() <= epsilon_sq)
+            {
+                ++stats_.joint_writes_skipped;
+                continue;
+            }
+            pose.SetPosition(solved);
+            amo->SetAvatarMemory(ik_node->guid, pose);
+        }
+        ++stats_.joint_writes;
     }
 }
 
+bool SimpleIKModule::GetPolePosition(const ActorBinding& binding, LPoint3f& pole) const
+{
+    // the pole target follows the current actor.
+    const NodePath space = binding.joints.front().get_parent();
+    if (pole_target_ && &binding == binding_)
+    {
+        pole = pole_target_.get_pos(space);
+        return true;
+    }
+
+    const auto& chest_joints = binding.chest_joints;
+    if (chest_joints.empty())
+        return false;
+
+    // elbow hangs down and backward from the shoulder in the chest frame
+    const LPoint3f bottom = chest_joints[0].get_pos(space);
+    const LPoint3f top = chest_joints[1].get_pos(space);
+    const LPoint3f left = chest_joints[2].get_pos(space);
+    const LPoint3f right = chest_joints[3].get_pos(space);
+    LVector3f up = top - bottom;
+    LVector3f side = right - left;
+    if (!up.normalize() || !side.normalize())
+        return false;
+    const LVector3f forward = up.cross(side);
+
+    const LPoint3f shoulder = binding.joints[1].get_pos(space);
+    const float outward = (shoulder - (left + right) * 0.5f).dot(side) >= 0 ? 1.0f : -1.0f;
+
+    const float length = binding.chain->get_length(1);
+
+    pole = shoulder + (-up - forward * 0.5f + side * (0.3f * outward)) * length;
+    return true;
+}
+
+void SimpleIKModule::UpdateDistances(ArmChain& chain, const LVecBase3f& scale)
+{
+    const auto& nodes = chain.get_nodes();
+
+    // the key is the content of the bind pose, so a reloaded model or memory at a reused address is not confused.
+    uint64_t key = 14695981039346656037ull;
+    for (const auto* node: nodes)
+    {
+        for (const auto v: node->position.f)
+            hash_value(key, v);
+        for (const auto v: node->rotation.f)
+            hash_value(key, v);
+    }
+    for (const auto v: scale)
+        hash_value(key, v);
+
+    auto& lengths = bone_length_cache_[key];
+    if (lengths.size() == nodes.size())
+    {
+        for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
+            nodes[k]->dist_to_parent = lengths[k];
+        return;
+    }
+
+    chain.update_distances();
+
+    lengths.resize(nodes.size());
+    for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
+        lengths[k] = nodes[k]->dist_to_parent;
+}
+
 void SimpleIKModule::StartSolveIKLoop()
 {
     if (update_ik_task_)
@@ -174,6 +608,7 @@ void SimpleIKModule::StartSolveIKLoop()
 
     update_ik_task_ = add_task([this](const rppanda::FunctionalTask* task) {
         SolveIK();
+        SolveFootPlacement();
         return AsyncTask::DoneStatus::DS_cont;
     }, "SimpleIKModule::StartSolveIKLoop");
 }
@@ -183,3 +618,45 @@ void SimpleIKModule::StopSolveIKLoop()
     if (update_ik_task_)
         update_ik_task_->remove();
 }
+
+void SimpleIKModule::ClearPoseCache()
+{
+    // caches are cleared in place, because bindings point them.
+    for (auto&& skeleton_cache: pose_caches_)
+        skeleton_cache.second.clear();
+}
+
+void SimpleIKModule::SetSelfCollisionProxies(const std::vector<CapsuleProxy>& proxies)
+{
+    capsule_proxies_ = proxies;
+
+    for (auto&& binding: actor_bindings_)
+        BindSelfCollision(*binding.second);
+}
+
+void SimpleIKModule::BindSelfCollision(ActorBinding& binding) const
+{
+    binding.self_collision = std::make_unique<SelfCollision>();
+    if (!binding.self_collision->bind(binding.actor_np, binding.joints.front().get_parent(), capsule_proxies_))
+        binding.self_collision.reset();
+}
+
+bool SimpleIKModule::AddFootPlacement(crsf::TActorObject* actor)
+{
+    if (!foot_placement_)
+        return false;
+
+    return foot_placement_->add_actor(actor);
+}
+
+void SimpleIKModule::RemoveFootPlacement(crsf::TActorObject* actor)
+{
+    if (foot_placement_)
+        foot_placement_->remove_actor(actor);
+}
+
+void SimpleIKModule::SolveFootPlacement()
+{
+    if (foot_placement_)
+        foot_placement_->solve(ground_query_, stats_);
+}
@@ -0,0 +1,151 @@
+#include "pose_cache.hpp"
+
+#include <cmath>
+
+#include <ik/ik.h>
+
+namespace {
+
+// size of a cell of the coarse grid in cells of the exact grid
+constexpr int32_t coarse_factor = 8;
+
+int32_t floor_div(int32_t value, int32_t divisor)
+{
+    return value >= 0 ? value / divisor : (value - divisor + 1) / divisor;
+}
+
+}
+
+size_t PoseCache::KeyHash::operator()(const Key& key) const
+{
+    // FNV-1a
+    size_t hash = 14695981039346656037ull;
+    for (const auto v: key)
+    {
+        hash ^= static_cast<uint32_t>(v);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+PoseCache::PoseCache(size_t capacity, float position_step, float rotation_step):
+    capacity_(capacity), position_step_(position_step), rotation_step_(rotation_step)
+{
+    entries_.reserve(capacity_);
+    coarse_entries_.reserve(capacity_);
+}
+
+auto PoseCache::make_key(const LVecBase3f& target, const LVecBase3f& root_pos, const LQuaternionf& root_quat) const -> Key
+{
+    // q and -q are the same rotation
+    LQuaternionf quat = root_quat;
+    if (quat.get_r() < 0)
+        quat = LQuaternionf(-quat.get_r(), -quat.get_i(), -quat.get_j(), -quat.get_k());
+
+    Key key;
+    for (int k = 0; k < 3; ++k)
+    {
+        key[k] = static_cast<int32_t>(std::floor(target[k] / position_step_));
+        key[3 + k] = static_cast<int32_t>(std::floor(root_pos[k] / position_step_));
+    }
+    for (int k = 0; k < 4; ++k)
+        key[6 + k] = static_cast<int32_t>(std::floor(quat[k] / rotation_step_));
+    return key;
+}
+
+auto PoseCache::make_coarse_key(const Key& key) const -> Key
+{
+    // only the target is coarse, because a different root transform changes the body around the chain.
+    Key coarse = key;
+    for (int k = 0; k < 3; ++k)
+        coarse[k] = floor_div(key[k], coarse_factor);
+    return coarse;
+}
+
+auto PoseCache::find(const Key& key, const std::vector<ik_node_t*>& nodes) -> HitType
+{
+    ++tick_;
+
+    auto iter = entries_.find(key);
+    if (iter != entries_.end())
+    {
+        iter->second.last_used = tick_;
+        restore(iter->second, nodes);
+        return HitType::exact_hit;
+    }
+
+    auto coarse_iter = coarse_entries_.find(make_coarse_key(key));
+    if (coarse_iter == coarse_entries_.end())
+        return HitType::miss;
+
+    iter = entries_.find(coarse_iter->second);
+    if (iter == entries_.end())
+        return HitType::miss;
+
+    iter->second.last_used = tick_;
+    restore(iter->second, nodes);
+    return HitType::near_hit;
+}
+
+void PoseCache::insert(const Key& key, const std::vector<ik_node_t*>& nodes)
+{
+    if (capacity_ == 0)
+        return;
+
+    if (entries_.find(key) == entries_.end() && entries_.size() >= capacity_)
+    {
+        // evict the least recently used entry
+        auto lru = entries_.begin();
+        for (auto iter = entries_.begin(), iter_end = entries_.end(); iter != iter_end; ++iter)
+        {
+            if (iter->second.last_used < lru->second.last_used)
+                lru = iter;
+        }
+
+        auto coarse_iter = coarse_entries_.find(make_coarse_key(lru->first));
+        if (coarse_iter != coarse_entries_.end() && coarse_iter->second == lru->first)
+            coarse_entries_.erase(coarse_iter);
+        entries_.erase(lru);
+    }
+
+    auto& entry = entries_[key];
+    entry.last_used = tick_;
+    entry.positions.resize(nodes.size() * 3);
+    for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
+    {
+        entry.positions[k * 3 + 0] = nodes[k]->position.x;
+        entry.positions[k * 3 + 1] = nodes[k]->position.y;
+        entry.positions[k * 3 + 2] = nodes[k]->position.z;
+    }
+
+    coarse_entries_[make_coarse_key(key)] = key;
+}
+
+void PoseCache::clear()
+{
+    entries_.clear();
+    coarse_entries_.clear();
+}
+
+size_t PoseCache::get_memory_usage() const
+{
+    size_t bytes = sizeof(*this);
+    for (const auto& key_entry: entries_)
+        bytes += sizeof(key_entry) + key_entry.second.positions.capacity() * sizeof(double);
+    bytes += coarse_entries_.size() * sizeof(std::pair<const Key, Key>);
+    return bytes;
+}
+
+void PoseCache::restore(const Entry& entry, const std::vector<ik_node_t*>& nodes) const
+{
+    if (entry.positions.size() != nodes.size() * 3)
+        return;
+
+    for (size_t k = 0, k_end = nodes.size(); k < k_end; ++k)
+    {
+        nodes[k]->position = ik.vec3.vec3(
+            entry.positions[k * 3 + 0],
+            entry.positions[k * 3 + 1],
+            entry.positions[k * 3 + 2]);
+    }
+}
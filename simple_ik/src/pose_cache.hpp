@@ -0,0 +1,70 @@
+#pragma once
+
+#include <luse.h>
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+struct ik_node_t;
+
+/**
+ * Small cache of solved chain poses keyed by the quantized target and root transform.
+ *
+ * An exact hit restores the solved pose, and a near hit (same cell in the coarse grid) gives
+ * a pose to warm-start the solver.
+ */
+class PoseCache
+{
+public:
+    enum class HitType
+    {
+        miss,
+        near_hit,
+        exact_hit,
+    };
+
+    using Key = std::array<int32_t, 10>;
+
+    PoseCache(size_t capacity = 64, float position_step = 0.5f, float rotation_step = 1.0f / 256.0f);
+
+    Key make_key(const LVecBase3f& target, const LVecBase3f& root_pos, const LQuaternionf& root_quat) const;
+
+    /** Copy cached positions to @a nodes if it is found. */
+    HitType find(const Key& key, const std::vector<ik_node_t*>& nodes);
+
+    void insert(const Key& key, const std::vector<ik_node_t*>& nodes);
+
+    void clear();
+
+    size_t size() const;
+    size_t get_memory_usage() const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        std::vector<double> positions;
+        uint64_t last_used;
+    };
+
+    Key make_coarse_key(const Key& key) const;
+    void restore(const Entry& entry, const std::vector<ik_node_t*>& nodes) const;
+
+    size_t capacity_;
+    float position_step_;
+    float rotation_step_;
+
+    uint64_t tick_ = 0;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    std::unordered_map<Key, Key, KeyHash> coarse_entries_;     // coarse key to the latest exact key
+};
+
+inline size_t PoseCache::size() const
+{
+    return entries_.size();
+}
@@ -0,0 +1,228 @@
+#include "self_collision.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMPLE_IK_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <ik/ik.h>
+
+#include "chain_space.hpp"
+
+namespace {
+
+// degenerated capsule of padding lanes never penetrates.
+constexpr float padding_radius = -1e30f;
+
+}
+
+void CapsuleSet::clear()
+{
+    size_ = 0;
+    for (auto* v: { &ax_, &ay_, &az_, &bx_, &by_, &bz_, &radius_, &depth_, &s_, &t_ })
+        v->clear();
+}
+
+void CapsuleSet::push_back(const LPoint3f& a, const LPoint3f& b, float radius)
+{
+    const size_t padded_size = (size_ + 1 + lane_count - 1) / lane_count * lane_count;
+    for (auto* v: { &ax_, &ay_, &az_, &bx_, &by_, &bz_ })
+        v->resize(padded_size, 0.0f);
+    radius_.resize(padded_size, padding_radius);
+    depth_.resize(padded_size);
+    s_.resize(padded_size);
+    t_.resize(padded_size);
+
+    radius_[size_] = radius;
+    set_segment(size_, a, b);
+    ++size_;
+}
+
+void CapsuleSet::set_segment(size_t index, const LPoint3f& a, const LPoint3f& b)
+{
+    ax_[index] = a[0];
+    ay_[index] = a[1];
+    az_[index] = a[2];
+    bx_[index] = b[0];
+    by_[index] = b[1];
+    bz_[index] = b[2];
+}
+
+bool CapsuleSet::find_deepest(const LPoint3f& p, const LPoint3f& q, float radius, CapsuleContact& contact) const
+{
+    if (size_ == 0)
+        return false;
+
+    // closest points between the segment and capsule axes (Ericson, Real-Time Collision Detection 5.1.9)
+    // The parameter of the segment is recomputed from the clamped parameter of the axis, so it is branchless.
+    const LVector3f d1 = q - p;
+    const float a = (std::max)(d1.length_squared(), 1e-12f);
+    const size_t padded_size = radius_.size();
+
+#ifdef SIMPLE_IK_USE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 eps = _mm_set1_ps(1e-12f);
+    const __m128 px = _mm_set1_ps(p[0]);
+    const __m128 py = _mm_set1_ps(p[1]);
+    const __m128 pz = _mm_set1_ps(p[2]);
+    const __m128 d1x = _mm_set1_ps(d1[0]);
+    const __m128 d1y = _mm_set1_ps(d1[1]);
+    const __m128 d1z = _mm_set1_ps(d1[2]);
+    const __m128 a4 = _mm_set1_ps(a);
+    const __m128 r4 = _mm_set1_ps(radius);
+
+    for (size_t k = 0; k < padded_size; k += lane_count)
+    {
+        const __m128 ax = _mm_loadu_ps(&ax_[k]);
+        const __m128 ay = _mm_loadu_ps(&ay_[k]);
+        const __m128 az = _mm_loadu_ps(&az_[k]);
+        const __m128 d2x = _mm_sub_ps(_mm_loadu_ps(&bx_[k]), ax);
+        const __m128 d2y = _mm_sub_ps(_mm_loadu_ps(&by_[k]), ay);
+        const __m128 d2z = _mm_sub_ps(_mm_loadu_ps(&bz_[k]), az);
+        const __m128 rx = _mm_sub_ps(px, ax);
+        const __m128 ry = _mm_sub_ps(py, ay);
+        const __m128 rz = _mm_sub_ps(pz, az);
+
+        const __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d2x, d2x), _mm_mul_ps(d2y, d2y)), _mm_mul_ps(d2z, d2z));
+        const __m128 f = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d2x, rx), _mm_mul_ps(d2y, ry)), _mm_mul_ps(d2z, rz));
+        const __m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d1x, rx), _mm_mul_ps(d1y, ry)), _mm_mul_ps(d1z, rz));
+        const __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d1x, d2x), _mm_mul_ps(d1y, d2y)), _mm_mul_ps(d1z, d2z));
+
+        // s = 0 for parallel segments
+        const __m128 denom = _mm_sub_ps(_mm_mul_ps(a4, e), _mm_mul_ps(b, b));
+        const __m128 not_parallel = _mm_cmpgt_ps(denom, eps);
+        __m128 s = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(b, f), _mm_mul_ps(c, e)), _mm_max_ps(denom, eps));
+        s = _mm_and_ps(not_parallel, _mm_min_ps(_mm_max_ps(s, zero), one));
+
+        __m128 t = _mm_div_ps(_mm_add_ps(_mm_mul_ps(b, s), f), _mm_max_ps(e, eps));
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+        s = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(b, t), c), a4);
+        s = _mm_min_ps(_mm_max_ps(s, zero), one);
+
+        const __m128 dx = _mm_sub_ps(_mm_add_ps(rx, _mm_mul_ps(d1x, s)), _mm_mul_ps(d2x, t));
+        const __m128 dy = _mm_sub_ps(_mm_add_ps(ry, _mm_mul_ps(d1y, s)), _mm_mul_ps(d2y, t));
+        const __m128 dz = _mm_sub_ps(_mm_add_ps(rz, _mm_mul_ps(d1z, s)), _mm_mul_ps(d2z, t));
+        const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+        _mm_storeu_ps(&depth_[k], _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&radius_[k]), r4), dist));
+        _mm_storeu_ps(&s_[k], s);
+        _mm_storeu_ps(&t_[k], t);
+    }
+#else
+    for (size_t k = 0; k < padded_size; ++k)
+    {
+        const LVector3f d2(bx_[k] - ax_[k], by_[k] - ay_[k], bz_[k] - az_[k]);
+        const LVector3f r(p[0] - ax_[k], p[1] - ay_[k], p[2] - az_[k]);
+        const float e = d2.length_squared();
+        const float f = d2.dot(r);
+        const float c = d1.dot(r);
+        const float b = d1.dot(d2);
+
+        const float denom = a * e - b * b;
+        float s = denom > 1e-12f ? (std::min)((std::max)((b * f - c * e) / denom, 0.0f), 1.0f) : 0.0f;
+        const float t = (std::min)((std::max)((b * s + f) / (std::max)(e, 1e-12f), 0.0f), 1.0f);
+        s = (std::min)((std::max)((b * t - c) / a, 0.0f), 1.0f);
+
+        depth_[k] = radius_[k] + radius - (r + d1 * s - d2 * t).length();
+        s_[k] = s;
+        t_[k] = t;
+    }
+#endif
+
+    const auto deepest = std::max_element(depth_.begin(), depth_.begin() + size_);
+    if (*deepest <= 0.0f)
+        return false;
+
+    const size_t index = std::distance(depth_.begin(), deepest);
+    const LPoint3f capsule_a(ax_[index], ay_[index], az_[index]);
+    const LPoint3f capsule_b(bx_[index], by_[index], bz_[index]);
+    const LPoint3f closest = p + d1 * s_[index];
+
+    contact.index = index;
+    contact.depth = *deepest;
+    contact.s = s_[index];
+    contact.normal = closest - (capsule_a + (capsule_b - capsule_a) * t_[index]);
+    if (!contact.normal.normalize())
+        contact.normal = LVector3f::forward();
+
+    return true;
+}
+
+// ************************************************************************************************
+
+const std::vector<SimpleIKModule::CapsuleProxy>& SelfCollision::get_default_proxies()
+{
+    // H-Anim joints of the torso and head. unit is cm.
+    static const std::vector<SimpleIKModule::CapsuleProxy> proxies = {
+        { "sacroiliac", "vl1", 14.0f },
+        { "vl1", "vt6", 15.0f },
+        { "vt6", "vc7", 13.0f },
+        { "vc7", "skullbase", 6.0f },
+        { "skullbase", "skullbase", 11.0f },
+    };
+    return proxies;
+}
+
+bool SelfCollision::bind(NodePath actor_np, NodePath space, const std::vector<SimpleIKModule::CapsuleProxy>& proxies)
+{
+    space_ = space;
+    joints_a_.clear();
+    joints_b_.clear();
+    capsules_.clear();
+
+    for (const auto& proxy: proxies)
+    {
+        NodePath a = actor_np.find("**/" + proxy.joint_a);
+        NodePath b = actor_np.find("**/" + proxy.joint_b);
+        if (!a || !b)
+            continue;
+
+        joints_a_.push_back(a);
+        joints_b_.push_back(b);
+        capsules_.push_back(a.get_pos(space_), b.get_pos(space_), proxy.radius);
+    }
+
+    return capsules_.size() > 0;
+}
+
+void SelfCollision::update_capsules()
+{
+    for (size_t k = 0, k_end = capsules_.size(); k < k_end; ++k)
+        capsules_.set_segment(k, joints_a_[k].get_pos(space_), joints_b_[k].get_pos(space_));
+}
+
+size_t SelfCollision::resolve(const std::vector<ik_node_t*>& nodes, float chain_radius)
+{
+    const size_t count = nodes.size();
+    if (count < 3 || capsules_.size() == 0)
+        return 0;
+
+    chain_to_space(nodes, positions_, rotations_);
+
+    // the first segment is attached to the torso, so the joint after the first segment is fixed, too.
+    size_t contact_count = 0;
+    CapsuleContact contact;
+    for (size_t k = 1; k + 1 < count; ++k)
+    {
+        if (!capsules_.find_deepest(positions_[k], positions_[k + 1], chain_radius, contact))
+            continue;
+
+        ++contact_count;
+
+        const LVector3f push = contact.normal * contact.depth;
+        if (k >= 2)
+            positions_[k] += push * (1.0f - contact.s);
+        positions_[k + 1] += push * contact.s;
+    }
+
+    if (contact_count == 0)
+        return 0;
+
+    chain_from_space(nodes, positions_, rotations_, 2);
+
+    return contact_count;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <nodePath.h>
+
+#include "simple_ik/module.h"
+
+struct CapsuleContact
+{
+    size_t index;
+    float depth;                // penetration depth
+    float s;                    // parameter of the closest point on the segment
+    LVector3f normal;           // from the capsule to the segment
+};
+
+/**
+ * Capsules in SoA layout which are padded to multiple of SIMD lanes.
+ */
+class CapsuleSet
+{
+public:
+    static constexpr size_t lane_count = 4;
+
+    void clear();
+    void push_back(const LPoint3f& a, const LPoint3f& b, float radius);
+    void set_segment(size_t index, const LPoint3f& a, const LPoint3f& b);
+
+    size_t size() const;
+
+    /** Find the capsule which penetrates the segment (p, q) with @a radius most deeply. */
+    bool find_deepest(const LPoint3f& p, const LPoint3f& q, float radius, CapsuleContact& contact) const;
+
+private:
+    size_t size_ = 0;
+    std::vector<float> ax_, ay_, az_;
+    std::vector<float> bx_, by_, bz_;
+    std::vector<float> radius_;
+
+    // per-lane results of the kernel
+    mutable std::vector<float> depth_;
+    mutable std::vector<float> s_;
+    mutable std::vector<float> t_;
+};
+
+inline size_t CapsuleSet::size() const
+{
+    return size_;
+}
+
+/**
+ * Capsule proxies of a skeleton to push the IK chain out of the body.
+ */
+class SelfCollision
+{
+public:
+    static const std::vector<SimpleIKModule::CapsuleProxy>& get_default_proxies();
+
+    /**
+     * Resolve proxy joints of the actor.
+     * @param space     Parent of the chain root where the IK chain is solved.
+     */
+    bool bind(NodePath actor_np, NodePath space, const std::vector<SimpleIKModule::CapsuleProxy>& proxies);
+
+    /** Update capsules from the current joints. */
+    void update_capsules();
+
+    /**
+     * Push each segment of the chain out of the deepest penetrating capsule.
+     * @return  The number of contacts.
+     */
+    size_t resolve(const std::vector<ik_node_t*>& nodes, float chain_radius);
+
+private:
+    NodePath space_;
+    std::vector<NodePath> joints_a_;
+    std::vector<NodePath> joints_b_;
+    CapsuleSet capsules_;
+
+    // chain in the solving space
+    std::vector<LPoint3f> positions_;
+    std::vector<LQuaternionf> rotations_;
+};